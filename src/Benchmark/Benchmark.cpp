@@ -0,0 +1,231 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "Benchmark.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#if defined( WIN32 )
+#include <psapi.h>
+#pragma		comment(lib, "Psapi.lib")
+#elif defined( __linux__ )
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> NumAllocations{ 0U };
+static thread_local uint64_t NumThreadAllocations = 0U;
+static volatile uint64_t ConsumedValue = 0U;
+
+// Every allocation in the process goes through here, so the benchmarks can tell how many a code path makes
+void* operator new( size_t size )
+{
+	NumAllocations.fetch_add( 1U, std::memory_order_relaxed );
+	NumThreadAllocations++;
+
+	void* memory = std::malloc( size > 0U ? size : 1U );
+	if ( nullptr == memory )
+	{
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+void* operator new[]( size_t size )
+{
+	return operator new( size );
+}
+
+void operator delete( void* memory ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete[]( void* memory ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete( void* memory, size_t ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete[]( void* memory, size_t ) noexcept
+{
+	std::free( memory );
+}
+
+// ============================
+// BenchmarkSuite::BenchmarkSuite
+// ============================
+BenchmarkSuite::BenchmarkSuite( std::string_view nameFilter, float minimumRunSeconds )
+	: filter( nameFilter ), minimumSeconds( minimumRunSeconds )
+{
+}
+
+// ============================
+// BenchmarkSuite::IsEnabled
+// ============================
+bool BenchmarkSuite::IsEnabled( std::string_view name ) const
+{
+	return name.find( filter ) != std::string_view::npos;
+}
+
+// ============================
+// BenchmarkSuite::Add
+// ============================
+BenchmarkResult& BenchmarkSuite::Add( std::string_view name, uint64_t iterations, double seconds )
+{
+	BenchmarkResult& result = results.emplace_back();
+	result.name = name;
+	result.iterations = iterations;
+	result.nanosecondsPerIteration = iterations > 0U ? seconds * 1'000'000'000.0 / double( iterations ) : 0.0;
+
+	// Progress goes to stderr, so stdout can take the JSON
+	fprintf( stderr, "%-48s %12.1f ns\n", result.name.c_str(), result.nanosecondsPerIteration );
+	return result;
+}
+
+// ============================
+// BenchmarkSuite::PrintSummary
+// ============================
+void BenchmarkSuite::PrintSummary( FILE* file ) const
+{
+	for ( const BenchmarkResult& result : results )
+	{
+		fprintf( file, "%-48s %12.1f ns  x%llu\n", result.name.c_str(), result.nanosecondsPerIteration,
+			(unsigned long long)result.iterations );
+
+		for ( const auto& [metricName, value] : result.metrics )
+		{
+			fprintf( file, "    %-44s %14.3f\n", metricName.c_str(), value );
+		}
+	}
+}
+
+// ============================
+// BenchmarkSuite::WriteJson
+//
+// {
+//     "benchmarks": [
+//         { "name": "...", "iterations": N, "ns_per_iteration": X, "metrics": { "...": Y } },
+//         ...
+//     ]
+// }
+// Names are plain identifiers, so nothing needs escaping
+// ============================
+void BenchmarkSuite::WriteJson( FILE* file ) const
+{
+	fprintf( file, "{\n\t\"benchmarks\": [\n" );
+
+	for ( size_t i = 0U; i < results.size(); i++ )
+	{
+		const BenchmarkResult& result = results[i];
+		fprintf( file, "\t\t{ \"name\": \"%s\", \"iterations\": %llu, \"ns_per_iteration\": %.3f, \"metrics\": {",
+			result.name.c_str(), (unsigned long long)result.iterations, result.nanosecondsPerIteration );
+
+		for ( size_t m = 0U; m < result.metrics.size(); m++ )
+		{
+			fprintf( file, "%s \"%s\": %.6g", m > 0U ? "," : "", result.metrics[m].first.c_str(), result.metrics[m].second );
+		}
+
+		fprintf( file, " } }%s\n", i + 1U < results.size() ? "," : "" );
+	}
+
+	fprintf( file, "\t]\n}\n" );
+}
+
+// ============================
+// Consume
+// ============================
+void Consume( uint64_t value )
+{
+	ConsumedValue = ConsumedValue + value;
+}
+
+// ============================
+// GenerateLogTexts
+// ============================
+std::vector<std::string> GenerateLogTexts( size_t count, uint32_t seed )
+{
+	constexpr std::string_view Words[] =
+	{
+		"[Renderer]", "loaded", "texture", "models/props/crate01.dmx", "in", "12.5", "ms", "entity", "spawned",
+		"warning:", "missing", "material", "physics", "step", "took", "longer", "than", "expected", "0x3f2a"
+	};
+	constexpr char ColourCodes[] = { 'r', 'g', 'b', 'y', 'c', 'w' };
+
+	std::mt19937 random( seed );
+	std::uniform_int_distribution<size_t> lengthDistribution( 16U, 120U );
+
+	std::vector<std::string> texts( count );
+	for ( std::string& text : texts )
+	{
+		const size_t length = lengthDistribution( random );
+		while ( text.size() < length )
+		{
+			if ( random() % 20U == 0U )
+			{
+				text.push_back( '$' );
+				text.push_back( ColourCodes[random() % std::size( ColourCodes )] );
+			}
+
+			text.append( Words[random() % std::size( Words )] );
+			text.push_back( ' ' );
+		}
+	}
+
+	return texts;
+}
+
+// ============================
+// GetNumAllocations
+// ============================
+uint64_t GetNumAllocations()
+{
+	return NumAllocations.load( std::memory_order_relaxed );
+}
+
+// ============================
+// GetNumThreadAllocations
+// ============================
+uint64_t GetNumThreadAllocations()
+{
+	return NumThreadAllocations;
+}
+
+// ============================
+// GetResidentBytes
+// ============================
+size_t GetResidentBytes()
+{
+#if defined( WIN32 )
+	PROCESS_MEMORY_COUNTERS counters{};
+	if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+	{
+		return counters.WorkingSetSize;
+	}
+	return 0U;
+#elif defined( __linux__ )
+	// Second field is the resident set, in pages
+	FILE* file = fopen( "/proc/self/statm", "r" );
+	if ( nullptr == file )
+	{
+		return 0U;
+	}
+
+	unsigned long long totalPages = 0U;
+	unsigned long long residentPages = 0U;
+	const int numRead = fscanf( file, "%llu %llu", &totalPages, &residentPages );
+	fclose( file );
+
+	return numRead == 2 ? size_t( residentPages ) * size_t( sysconf( _SC_PAGESIZE ) ) : 0U;
+#else
+	return 0U;
+#endif
+}
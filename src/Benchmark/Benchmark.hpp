@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// One entry of the results
+struct BenchmarkResult
+{
+	std::string name;
+	uint64_t iterations{ 0U };
+	double nanosecondsPerIteration{ 0.0 };
+	// Anything else worth reporting, throughput, percentiles, allocation counts...
+	std::vector<std::pair<std::string, double>> metrics{};
+
+	BenchmarkResult& Metric( std::string_view metricName, double value )
+	{
+		metrics.emplace_back( std::string( metricName ), value );
+		return *this;
+	}
+};
+
+// ============================
+// BenchmarkSuite
+//
+// Times the hot paths of the console and collects the results, which are written out as JSON
+// so runs can be compared between commits
+// ============================
+class BenchmarkSuite final
+{
+public:
+	// Benchmarks are skipped unless their name contains nameFilter
+	// Timed loops are repeated until they've run for at least minimumSeconds
+	BenchmarkSuite( std::string_view nameFilter, float minimumRunSeconds );
+
+	bool IsEnabled( std::string_view name ) const;
+
+	// Calls fn( iterations ) with a growing iteration count until it runs long enough
+	// fn must do the measured work exactly that many times
+	template<typename Fn>
+	BenchmarkResult* Run( std::string_view name, Fn&& fn )
+	{
+		if ( !IsEnabled( name ) )
+		{
+			return nullptr;
+		}
+
+		uint64_t iterations = 1U;
+		while ( true )
+		{
+			const auto start = std::chrono::steady_clock::now();
+			fn( iterations );
+			const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+			if ( seconds >= minimumSeconds || iterations >= MaxIterations )
+			{
+				return &Add( name, iterations, seconds );
+			}
+
+			// Aim a bit past the minimum, so it usually takes one more round
+			const double scale = seconds > 0.0 ? minimumSeconds * 1.5 / seconds : 100.0;
+			iterations = std::min( MaxIterations, uint64_t( double( iterations ) * std::clamp( scale, 2.0, 100.0 ) ) );
+		}
+	}
+
+	// For benchmarks that do their own timing
+	BenchmarkResult& Add( std::string_view name, uint64_t iterations, double seconds );
+
+	void PrintSummary( FILE* file ) const;
+	void WriteJson( FILE* file ) const;
+
+private:
+	static constexpr uint64_t MaxIterations = 1ULL << 32U;
+
+	std::string filter;
+	float minimumSeconds;
+	std::vector<BenchmarkResult> results{};
+};
+
+// Keeps the optimiser from throwing away work whose result is otherwise unused
+void Consume( uint64_t value );
+
+// Log lines like the engine prints, 16 to 120 characters with the occasional colour code
+std::vector<std::string> GenerateLogTexts( size_t count, uint32_t seed = 1U );
+
+// Counted by the replaced global operator new, on all threads or only the calling one
+uint64_t GetNumAllocations();
+uint64_t GetNumThreadAllocations();
+// Resident memory of the whole process in bytes, 0 where it can't be queried
+size_t GetResidentBytes();
+
+// Defined in ModelBenchmarks.cpp, NetworkBenchmarks.cpp, SearchBenchmarks.cpp and ViewBenchmarks.cpp
+// Pushes are timed for every history size, like the full render
+void RunModelBenchmarks( BenchmarkSuite& suite, const std::vector<size_t>& historySizes );
+// Indexed search against a linear scan, over a million lines
+void RunSearchBenchmarks( BenchmarkSuite& suite );
+void RunNetworkBenchmarks( BenchmarkSuite& suite );
+// Connects to mock bridges over loopback, takes several seconds each
+void RunLoopbackBenchmarks( BenchmarkSuite& suite );
+void RunViewBenchmarks( BenchmarkSuite& suite, const std::vector<size_t>& historySizes );
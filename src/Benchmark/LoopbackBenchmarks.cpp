@@ -0,0 +1,325 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include <deque>
+#include "Benchmark.hpp"
+#include "MockBridge/MockBridge.hpp"
+#include "Model/MessageHistory.hpp"
+#include "Network/Network.hpp"
+#include "Network/PacketAllocator.hpp"
+#include "View/ConsoleView.hpp"
+
+// Out of the way of an engine that might be running on the default port
+constexpr uint16_t BasePort = 23905U;
+// Connecting to an engine that is already listening takes a few milliseconds
+constexpr float ConnectTimeout = 5.0f;
+constexpr float WarmupSeconds = 0.5f;
+constexpr float MeasureSeconds = 3.0f;
+constexpr float FrameInterval = 1.0f / 60.0f;
+
+// ============================
+// BridgeRunner
+//
+// A mock bridge serviced on a thread of its own
+// ============================
+class BridgeRunner final
+{
+public:
+	bool Start( const LoadProfile& profile )
+	{
+		if ( !bridge.Init( profile ) )
+		{
+			return false;
+		}
+
+		thread = std::thread( [this]
+			{
+				while ( !stop )
+				{
+					bridge.Update( 1U );
+				}
+				bridge.Shutdown();
+			} );
+
+		return true;
+	}
+
+	void Stop()
+	{
+		stop = true;
+		thread.join();
+	}
+
+private:
+	MockBridge bridge{};
+	std::thread thread;
+	std::atomic<bool> stop{ false };
+};
+
+// ============================
+// RunLoopback
+//
+// Connects a console to one mock bridge per profile, and feeds what it receives into an off-screen view
+// that draws at 60 Hz, like the terminal would. After connecting and warming up, everything is measured
+// for MeasureSeconds, the result has one iteration per received message.
+// onMessages is called on the network thread for every packet,
+// onFrame( network ) on this thread before every frame that's being measured
+// ============================
+template<typename OnMessagesFn, typename OnFrameFn>
+static BenchmarkResult* RunLoopback( BenchmarkSuite& suite, std::string_view name, const std::vector<LoadProfile>& profiles,
+	OnMessagesFn&& onMessages, OnFrameFn&& onFrame )
+{
+	if ( !suite.IsEnabled( name ) )
+	{
+		return nullptr;
+	}
+
+	std::vector<std::unique_ptr<BridgeRunner>> bridges{};
+	std::vector<std::string> endpoints{};
+	for ( const LoadProfile& profile : profiles )
+	{
+		bridges.push_back( std::make_unique<BridgeRunner>() );
+		if ( !bridges.back()->Start( profile ) )
+		{
+			fprintf( stderr, "%s: failed to listen on port %u\n", std::string( name ).c_str(), unsigned( profile.port ) );
+			bridges.pop_back();
+			for ( auto& bridge : bridges )
+			{
+				bridge->Stop();
+			}
+			return nullptr;
+		}
+		endpoints.push_back( "127.0.0.1:" + std::to_string( profile.port ) );
+	}
+
+	std::atomic<uint64_t> numReceived{ 0U };
+	std::atomic<uint64_t> networkThreadAllocations{ 0U };
+
+	auto view = std::make_unique<ConsoleView>();
+	view->SetNumEngines( profiles.size() );
+	view->InitOffscreen( []( std::string_view, size_t ) {}, []( std::string_view ) {} );
+
+	Network network{};
+	network.Init( endpoints,
+		[&]( ConsoleMessage* messages, size_t numMessages )
+		{
+			numReceived += numMessages;
+			networkThreadAllocations = GetNumThreadAllocations();
+			onMessages( messages, numMessages );
+			view->OnLog( messages, numMessages );
+		},
+		[&]( AutocompleteRecords&& records, uint8_t source, bool isFullCatalogue )
+		{
+			view->OnAutocompleteCatalogue( std::move( records ), source, isFullCatalogue );
+		} );
+
+	Screen screen( 200, 60 );
+	const auto renderFor = [&]( float seconds, bool isMeasured, auto&& keepGoing )
+	{
+		double totalFrameSeconds = 0.0;
+		double longestFrameSeconds = 0.0;
+		uint64_t numFrames = 0U;
+
+		const float endTime = Now() + seconds;
+		while ( Now() < endTime && keepGoing() )
+		{
+			const float frameStart = Now();
+			if ( isMeasured )
+			{
+				onFrame( network );
+			}
+			view->RenderOffscreen( screen );
+
+			const double frameSeconds = Now() - frameStart;
+			totalFrameSeconds += frameSeconds;
+			longestFrameSeconds = std::max( longestFrameSeconds, frameSeconds );
+			numFrames++;
+
+			Wait( std::max( 0.0f, FrameInterval - float( frameSeconds ) ) );
+		}
+
+		return std::make_tuple( totalFrameSeconds, longestFrameSeconds, numFrames );
+	};
+
+	renderFor( ConnectTimeout, false, [&] { return numReceived == 0U; } );
+	const bool isConnected = numReceived > 0U;
+	if ( isConnected )
+	{
+		renderFor( WarmupSeconds, false, [] { return true; } );
+	}
+
+	const uint64_t receivedBefore = numReceived;
+	const uint64_t networkAllocationsBefore = networkThreadAllocations;
+	const uint64_t droppedBefore = view->GetNumDroppedMessages();
+	const FramePacer::Statistics framesBefore = view->GetFrameStatistics();
+	const PacketAllocator::Statistics packetsBefore = PacketAllocator::GetStatistics();
+	const size_t residentBefore = GetResidentBytes();
+	const uint64_t timeBefore = NowMicroseconds();
+
+	const auto [totalFrameSeconds, longestFrameSeconds, numFrames] = isConnected
+		? renderFor( MeasureSeconds, true, [] { return true; } ) : std::make_tuple( 0.0, 0.0, uint64_t( 0U ) );
+
+	const double seconds = (NowMicroseconds() - timeBefore) / 1'000'000.0;
+	const uint64_t received = numReceived - receivedBefore;
+	const uint64_t networkAllocations = networkThreadAllocations - networkAllocationsBefore;
+	const uint64_t dropped = view->GetNumDroppedMessages() - droppedBefore;
+	const FramePacer::Statistics framesAfter = view->GetFrameStatistics();
+	const uint64_t numPacedFrames = framesAfter.numFrames - framesBefore.numFrames;
+	const PacketAllocator::Statistics packetsAfter = PacketAllocator::GetStatistics();
+	const size_t residentAfter = GetResidentBytes();
+
+	network.Shutdown();
+	for ( auto& bridge : bridges )
+	{
+		bridge->Stop();
+	}
+
+	if ( !isConnected )
+	{
+		fprintf( stderr, "%s: never received anything from the mock bridges\n", std::string( name ).c_str() );
+		return nullptr;
+	}
+
+	// The bridges run in this process too, so the packet pool counts their side as well
+	const double perMessage = received > 0U ? 1.0 / double( received ) : 0.0;
+	return &suite.Add( name, received, seconds )
+		.Metric( "messages_per_second", double( received ) / seconds )
+		.Metric( "dropped_by_view", double( dropped ) )
+		.Metric( "frame_ms_mean", numFrames > 0U ? totalFrameSeconds * 1000.0 / double( numFrames ) : 0.0 )
+		.Metric( "frame_ms_max", longestFrameSeconds * 1000.0 )
+		.Metric( "messages_per_frame", numPacedFrames > 0U
+			? double( framesAfter.totalFrameMessages - framesBefore.totalFrameMessages ) / double( numPacedFrames ) : 0.0 )
+		.Metric( "messages_per_frame_max", double( framesAfter.maxFrameMessages ) )
+		.Metric( "network_thread_allocations_per_message", double( networkAllocations ) * perMessage )
+		.Metric( "packet_allocations_per_message", double( packetsAfter.numAllocations - packetsBefore.numAllocations ) * perMessage )
+		.Metric( "packet_system_allocations", double( packetsAfter.numSystemAllocations - packetsBefore.numSystemAllocations ) )
+		.Metric( "packet_system_allocations_per_message",
+			double( packetsAfter.numSystemAllocations - packetsBefore.numSystemAllocations ) * perMessage )
+		.Metric( "packet_pool_bytes", double( packetsAfter.pooledBytes ) )
+		.Metric( "resident_bytes", double( residentAfter ) )
+		.Metric( "resident_growth_bytes", double( residentAfter ) - double( residentBefore ) );
+}
+
+// Percentile of the latencies in microseconds, reorders them
+static double GetPercentile( std::vector<uint32_t>& latencies, float percentile )
+{
+	if ( latencies.empty() )
+	{
+		return 0.0;
+	}
+
+	const size_t index = std::min( latencies.size() - 1U, size_t( latencies.size() * percentile ) );
+	std::nth_element( latencies.begin(), latencies.begin() + index, latencies.end() );
+	return latencies[index];
+}
+
+// ============================
+// RunLoopbackBenchmarks
+// ============================
+void RunLoopbackBenchmarks( BenchmarkSuite& suite )
+{
+	const auto ignoreMessages = []( const ConsoleMessage*, size_t ) {};
+	const auto ignoreFrame = []( Network& ) {};
+
+	// One engine flooding the console, mostly reliable traffic
+	LoadProfile flood{};
+	flood.port = BasePort;
+	flood.messagesPerSecond = 50'000.0f;
+	flood.burstSize = 5'000U;
+	RunLoopback( suite, "loopback_flood_50k", { flood }, ignoreMessages, ignoreFrame );
+
+	// Only the packet pool off, so its packet_system_allocations_per_message and frame times
+	// are what ENet costs on the system allocator
+	PacketAllocator::SetPoolEnabled( false );
+	RunLoopback( suite, "loopback_flood_50k_no_pool", { flood }, ignoreMessages, ignoreFrame );
+	PacketAllocator::SetPoolEnabled( true );
+
+	// The same flood, handled the way it was before text was decoded in place and ENet had a pool:
+	// every message copied into a std::string on the network thread, that copied again into the
+	// list of lines, which keeps as many as the history does, and ENet on the system allocator
+	{
+		std::mutex linesMutex;
+		std::deque<std::string> lines{};
+		PacketAllocator::SetPoolEnabled( false );
+		RunLoopback( suite, "loopback_flood_50k_baseline", { flood },
+			[&]( const ConsoleMessage* messages, size_t numMessages )
+			{
+				for ( size_t i = 0U; i < numMessages; i++ )
+				{
+					const std::string text( messages[i].text );
+					std::lock_guard<std::mutex> lock( linesMutex );
+					lines.push_back( text );
+					if ( lines.size() > MessageHistory::DefaultCapacity )
+					{
+						lines.pop_front();
+					}
+				}
+			}, ignoreFrame );
+		PacketAllocator::SetPoolEnabled( true );
+	}
+
+	// Eight engines at once, their logs merged by time
+	std::vector<LoadProfile> engines( 8U );
+	for ( size_t i = 0U; i < engines.size(); i++ )
+	{
+		engines[i].port = uint16_t( BasePort + i );
+		engines[i].messagesPerSecond = 10'000.0f;
+		engines[i].seed = uint32_t( i + 1U );
+	}
+	RunLoopback( suite, "loopback_8_engines_10k", engines, ignoreMessages, ignoreFrame );
+
+	// How long a command takes to come back echoed while the logs are busy
+	// Sent at 20 Hz, the echo is "] bench_command N"
+	constexpr std::string_view EchoPrefix = "] bench_command ";
+	std::mutex latencyMutex;
+	std::vector<uint64_t> sendTimes{};
+	std::vector<uint32_t> latencies{};
+	float nextCommandTime = 0.0f;
+
+	LoadProfile busy{};
+	busy.port = BasePort;
+	busy.messagesPerSecond = 50'000.0f;
+
+	BenchmarkResult* result = RunLoopback( suite, "loopback_command_latency", { busy },
+		[&]( const ConsoleMessage* messages, size_t numMessages )
+		{
+			for ( size_t i = 0U; i < numMessages; i++ )
+			{
+				if ( messages[i].text.substr( 0U, EchoPrefix.size() ) != EchoPrefix )
+				{
+					continue;
+				}
+
+				const size_t id = size_t( std::atoll( std::string( messages[i].text.substr( EchoPrefix.size() ) ).c_str() ) );
+				std::lock_guard<std::mutex> lock( latencyMutex );
+				if ( id < sendTimes.size() )
+				{
+					latencies.push_back( uint32_t( NowMicroseconds() - sendTimes[id] ) );
+				}
+			}
+		},
+		[&]( Network& network )
+		{
+			if ( Now() < nextCommandTime )
+			{
+				return;
+			}
+			nextCommandTime = Now() + 0.05f;
+
+			size_t id;
+			{
+				std::lock_guard<std::mutex> lock( latencyMutex );
+				id = sendTimes.size();
+				sendTimes.push_back( NowMicroseconds() );
+			}
+			network.SubmitCommand( std::string( EchoPrefix.substr( 2U ) ) + std::to_string( id ) );
+		} );
+
+	if ( nullptr != result )
+	{
+		result->Metric( "commands_echoed", double( latencies.size() ) )
+			.Metric( "echo_ms_p50", GetPercentile( latencies, 0.5f ) / 1000.0 )
+			.Metric( "echo_ms_p99", GetPercentile( latencies, 0.99f ) / 1000.0 );
+	}
+}
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#ifdef WIN32
+#pragma		comment(lib, "Winmm.lib")
+#pragma		comment(lib, "Ws2_32.lib")
+#endif
+
+#include "Precompiled.hpp"
+#include <cstring>
+#include "Benchmark.hpp"
+#include "Network/PacketAllocator.hpp"
+
+namespace chrono = std::chrono;
+namespace this_thread = std::this_thread;
+
+void Wait( float seconds )
+{
+	this_thread::sleep_for( chrono::milliseconds( int( seconds * 1000.0f ) ) );
+}
+
+static chrono::time_point<chrono::steady_clock> StartupTime = chrono::steady_clock::now();
+float Now()
+{
+	return NowMicroseconds() / 1'000'000.0f;
+}
+
+uint64_t NowMicroseconds()
+{
+	return chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now() - StartupTime ).count();
+}
+
+void PrintUsage()
+{
+	printf( "Elegy.DevConsoleBenchmark: times the hot paths of the developer console, results go to stdout as JSON\n"
+		"  -filter NAME       only run benchmarks whose name contains NAME\n"
+		"  -time S            run each timed loop for at least S seconds (0.25)\n"
+		"  -history N,N,...   history sizes for history_push and the full render (1000,10000,100000,1000000)\n"
+		"  -loopback          also run the loopback scenarios against in-process mock bridges,\n"
+		"                     they use UDP ports 23905-23912 and take a few seconds each\n"
+		"  -o FILE            write the JSON to FILE instead, and a readable summary to stdout\n" );
+}
+
+int main( int argc, char** argv )
+{
+	std::string_view filter = "";
+	float minimumSeconds = 0.25f;
+	std::vector<size_t> historySizes = { 1'000U, 10'000U, 100'000U, 1'000'000U };
+	bool runLoopback = false;
+	const char* outputPath = nullptr;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const std::string_view argument = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if ( argument == "-loopback" )
+		{
+			runLoopback = true;
+		}
+		else if ( argument == "-filter" && nullptr != value )
+		{
+			filter = argv[++i];
+		}
+		else if ( argument == "-time" && nullptr != value )
+		{
+			minimumSeconds = std::max( 0.01f, float( std::atof( argv[++i] ) ) );
+		}
+		else if ( argument == "-history" && nullptr != value )
+		{
+			historySizes.clear();
+			const char* size = argv[++i];
+			while ( nullptr != size )
+			{
+				const long long historySize = std::atoll( size );
+				if ( historySize > 0 )
+				{
+					historySizes.push_back( size_t( historySize ) );
+				}
+
+				size = std::strchr( size, ',' );
+				size = nullptr != size ? size + 1 : nullptr;
+			}
+		}
+		else if ( argument == "-o" && nullptr != value )
+		{
+			outputPath = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return -1;
+		}
+	}
+
+	// The loopback scenarios create hosts before any Network does, so the pool has to be in place first
+	if ( PacketAllocator::InitialiseEnet() < 0 )
+	{
+		fprintf( stderr, "Failed to initialise ENet\n" );
+		return -1;
+	}
+
+	BenchmarkSuite suite( filter, minimumSeconds );
+	RunModelBenchmarks( suite, historySizes );
+	RunSearchBenchmarks( suite );
+	RunNetworkBenchmarks( suite );
+	RunViewBenchmarks( suite, historySizes );
+	if ( runLoopback )
+	{
+		RunLoopbackBenchmarks( suite );
+	}
+
+	enet_deinitialize();
+
+	if ( nullptr == outputPath )
+	{
+		suite.WriteJson( stdout );
+		return 0;
+	}
+
+	FILE* file = fopen( outputPath, "w" );
+	if ( nullptr == file )
+	{
+		fprintf( stderr, "Can't write to '%s'\n", outputPath );
+		return -1;
+	}
+
+	suite.WriteJson( file );
+	fclose( file );
+	suite.PrintSummary( stdout );
+	return 0;
+}
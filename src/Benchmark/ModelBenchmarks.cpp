@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "Benchmark.hpp"
+#include "Model/AutocompleteCatalogue.hpp"
+#include "Model/MessageHistory.hpp"
+
+// Catalogue entries the way the engine sends them, name#flags&value
+static std::vector<std::string> GenerateCatalogueEntries( size_t count )
+{
+	constexpr std::string_view Prefixes[] = { "r_", "cl_", "sv_", "phys_", "snd_", "net_", "ai_", "mat_" };
+	constexpr std::string_view Flags[] = { "", "#c", "#r", "#a" };
+
+	std::vector<std::string> entries( count );
+	for ( size_t i = 0U; i < count; i++ )
+	{
+		entries[i] = std::string( Prefixes[i % std::size( Prefixes )] ) + "setting_" + std::to_string( i * 7919U % count )
+			+ std::string( Flags[i % std::size( Flags )] ) + "&" + std::to_string( i % 100U );
+	}
+
+	return entries;
+}
+
+// Pushing into a full history, which evicts a message per push, so this is the steady state of a long session
+static void BenchmarkHistoryPush( BenchmarkSuite& suite, const std::vector<std::string>& texts, size_t historySize )
+{
+	const std::string name = "history_push_" + std::to_string( historySize );
+	if ( !suite.IsEnabled( name ) )
+	{
+		return;
+	}
+
+	auto history = std::make_unique<MessageHistory>( historySize );
+	for ( size_t i = 0U; i < historySize; i++ )
+	{
+		history->Push( ConsoleMessage( texts[i % texts.size()], i, ConsoleMessageType::Info ) );
+	}
+
+	size_t next = 0U;
+	uint64_t numAllocations = 0U;
+	BenchmarkResult* result = suite.Run( name, [&]( uint64_t iterations )
+		{
+			const uint64_t allocationsBefore = GetNumThreadAllocations();
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				history->Push( ConsoleMessage( texts[next], i, ConsoleMessageType::Info ) );
+				next = (next + 1U) % texts.size();
+			}
+			numAllocations = GetNumThreadAllocations() - allocationsBefore;
+			Consume( history->End() );
+		} );
+
+	result->Metric( "allocations_per_push", double( numAllocations ) / double( result->iterations ) )
+		.Metric( "history_bytes", double( history->GetMemoryUsage() ) );
+}
+
+// An engine loop printing the same line over and over, every run of repeats folds into one history line
+static void BenchmarkHistoryPushRepeated( BenchmarkSuite& suite, const std::vector<std::string>& texts )
+{
+	constexpr size_t RunLength = 16U;
+	MessageHistory history( 65536U );
+
+	size_t next = 0U;
+	size_t numStored = 0U;
+	BenchmarkResult* result = suite.Run( "history_push_repeated_16", [&]( uint64_t iterations )
+		{
+			const size_t endBefore = history.End();
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				history.Push( ConsoleMessage( texts[next / RunLength], i, ConsoleMessageType::Info ) );
+				next = (next + 1U) % (texts.size() * RunLength);
+			}
+			numStored = history.End() - endBefore;
+			Consume( history.End() );
+		} );
+
+	if ( nullptr != result )
+	{
+		result->Metric( "lines_per_push", double( numStored ) / double( result->iterations ) );
+	}
+}
+
+// ============================
+// RunModelBenchmarks
+// ============================
+void RunModelBenchmarks( BenchmarkSuite& suite, const std::vector<size_t>& historySizes )
+{
+	const std::vector<std::string> texts = GenerateLogTexts( 4096U );
+
+	for ( const size_t historySize : historySizes )
+	{
+		BenchmarkHistoryPush( suite, texts, historySize );
+	}
+	BenchmarkHistoryPushRepeated( suite, texts );
+
+	std::vector<char> destination( MessageHistory::TextChunkSize );
+	suite.Run( "colour_parse", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				ConsoleMessage message( texts[i % texts.size()] );
+				message.ParseColourCodes( destination.data() );
+				Consume( message.numColourSpans );
+			}
+		} );
+
+	// What the network thread does with every entry of a catalogue packet
+	const std::vector<std::string> entries = GenerateCatalogueEntries( 4096U );
+	AutocompleteRecords records{};
+	suite.Run( "autocomplete_parse_entry", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				if ( i % entries.size() == 0U )
+				{
+					records.Clear();
+				}
+				Consume( records.Add( entries[i % entries.size()] ) );
+			}
+		} );
+
+	// Parsing and sorting a whole catalogue, like on connecting
+	AutocompleteCatalogue catalogue{};
+	suite.Run( "autocomplete_catalogue_4096", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				AutocompleteRecords newRecords{};
+				newRecords.Reserve( entries.size() );
+				for ( const std::string& entry : entries )
+				{
+					newRecords.Add( entry );
+				}
+				catalogue.Assign( 1U, std::move( newRecords ) );
+			}
+			Consume( catalogue.GetRevision() );
+		} );
+
+	// Done whenever the command name in the input changes
+	constexpr std::string_view Prefixes[] = { "r", "cl_", "sv_set", "phys_setting_1", "mat_setting_40", "x" };
+	suite.Run( "autocomplete_find_prefix", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				const auto [first, last] = catalogue.FindPrefix( Prefixes[i % std::size( Prefixes )] );
+				Consume( last - first );
+			}
+		} );
+}
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "Benchmark.hpp"
+#include "Network/Network.hpp"
+#include "Network/PacketReader.hpp"
+#include "Network/PacketWriter.hpp"
+
+// 'M' packet bodies, without the leading 'M', the way Network::DecodeMessage gets them
+static std::vector<std::vector<uint8_t>> EncodeMessages( const std::vector<std::string>& texts, ProtocolVersion::Enum version )
+{
+	std::vector<std::vector<uint8_t>> packets( texts.size() );
+	for ( size_t i = 0U; i < texts.size(); i++ )
+	{
+		PacketWriter writer( packets[i] );
+		writer.WriteByte( uint8_t( i % 6U ) );
+		if ( version == ProtocolVersion::Legacy )
+		{
+			writer.WriteFloat( float( i ) * 0.001f );
+			writer.WriteUint16( uint16_t( texts[i].size() ) );
+		}
+		else
+		{
+			writer.WriteVarint( i * 1000U );
+			writer.WriteVarint( texts[i].size() );
+		}
+		writer.WriteString( texts[i] );
+	}
+
+	return packets;
+}
+
+// A 'B' packet body of all the texts, see Network::DecodeBatch
+static std::vector<uint8_t> EncodeBatch( const std::vector<std::string>& texts )
+{
+	std::vector<uint8_t> bytes{};
+	PacketWriter writer( bytes );
+	writer.WriteVarint( texts.size() );
+	writer.WriteVarint( 1'000'000U );
+	for ( size_t i = 0U; i < texts.size(); i++ )
+	{
+		writer.WriteByte( uint8_t( i % 6U ) );
+		writer.WriteVarint( 250U );
+		writer.WriteVarint( texts[i].size() );
+		writer.WriteString( texts[i] );
+	}
+
+	return bytes;
+}
+
+// How 'M' packets were decoded before PacketReader: fixed offsets, unaligned loads through
+// reinterpret_cast, no bounds checks, and the text copied out into a string
+// Kept as the baseline the current decoder is compared against
+struct HandOffsetMessage
+{
+	uint8_t type;
+	float timeSubmitted;
+	std::string text;
+};
+
+static HandOffsetMessage DecodeMessageHandOffset( const uint8_t* data )
+{
+	const int TypeOffset = 0;
+	const int TimeOffset = TypeOffset + sizeof( uint8_t );
+	const int LengthOffset = TimeOffset + sizeof( float );
+	const int TextOffset = LengthOffset + sizeof( uint16_t );
+
+	HandOffsetMessage message{};
+	message.type = data[TypeOffset];
+	message.timeSubmitted = *reinterpret_cast<const float*>( &data[TimeOffset] );
+
+	size_t messageLength = *reinterpret_cast<const uint16_t*>( &data[LengthOffset] );
+	message.text = std::string( reinterpret_cast<const char*>( &data[TextOffset] ), messageLength );
+	return message;
+}
+
+// ============================
+// RunNetworkBenchmarks
+// ============================
+void RunNetworkBenchmarks( BenchmarkSuite& suite )
+{
+	const std::vector<std::string> texts = GenerateLogTexts( 1024U );
+	const auto legacyPackets = EncodeMessages( texts, ProtocolVersion::Legacy );
+	const auto varintPackets = EncodeMessages( texts, ProtocolVersion::Varint );
+
+	suite.Run( "decode_message_hand_offset", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				const HandOffsetMessage message = DecodeMessageHandOffset( legacyPackets[i % legacyPackets.size()].data() );
+				Consume( message.text.size() );
+			}
+		} );
+
+	const auto benchmarkDecoder = [&]( std::string_view name, const std::vector<std::vector<uint8_t>>& packets,
+		ProtocolVersion::Enum version )
+	{
+		suite.Run( name, [&]( uint64_t iterations )
+			{
+				ConsoleMessage message{};
+				for ( uint64_t i = 0U; i < iterations; i++ )
+				{
+					const std::vector<uint8_t>& packet = packets[i % packets.size()];
+					Network::DecodeMessage( packet.data(), packet.size(), version, message );
+					Consume( message.text.size() );
+				}
+			} );
+	};
+
+	benchmarkDecoder( "decode_message_v1", legacyPackets, ProtocolVersion::Legacy );
+	benchmarkDecoder( "decode_message_v2", varintPackets, ProtocolVersion::Varint );
+
+	// One 'B' packet as the bridge sends them under load
+	constexpr size_t BatchSize = 64U;
+	const std::vector<uint8_t> batch = EncodeBatch( std::vector<std::string>( texts.begin(), texts.begin() + BatchSize ) );
+	std::vector<ConsoleMessage> decodedMessages{};
+	BenchmarkResult* result = suite.Run( "decode_batch_64", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				decodedMessages.clear();
+				PacketReader reader( batch.data(), batch.size() );
+				Consume( Network::DecodeBatch( reader, 1U, decodedMessages ) );
+			}
+		} );
+
+	if ( nullptr != result )
+	{
+		result->Metric( "ns_per_message", result->nanosecondsPerIteration / double( BatchSize ) );
+	}
+}
@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "Benchmark.hpp"
+#include "Model/MessageHistory.hpp"
+#include "Model/MessageSearch.hpp"
+
+constexpr size_t SearchHistorySize = 1'000'000U;
+
+struct SearchQuery
+{
+	std::string_view name;
+	std::string_view text;
+};
+
+// From one line, to a third of them, to none, plus one that's too short for the index
+// The generated texts only use a handful of words, so anything made of them is in every block
+constexpr SearchQuery SearchQueries[] =
+{
+	{ "rare", "id=424242" },
+	{ "medium", "ID=4242" },
+	{ "phrase", "CRATE01.dmx in" },
+	{ "common", "texture" },
+	{ "absent", "segfault" },
+	{ "short", "0x" }
+};
+
+// ============================
+// RunSearchBenchmarks
+// ============================
+void RunSearchBenchmarks( BenchmarkSuite& suite )
+{
+	// Updating the index is part of every push while the console runs
+	{
+		const std::vector<std::string> texts = GenerateLogTexts( 4096U );
+		MessageHistory history( 65536U );
+		MessageSearch search( history );
+
+		size_t next = 0U;
+		suite.Run( "history_push_indexed", [&]( uint64_t iterations )
+			{
+				for ( uint64_t i = 0U; i < iterations; i++ )
+				{
+					history.Push( ConsoleMessage( texts[next], i, ConsoleMessageType::Info ) );
+					search.Update();
+					next = (next + 1U) % texts.size();
+				}
+				Consume( search.GetMemoryUsage() );
+			} );
+	}
+
+	const std::string suffix = "_" + std::to_string( SearchHistorySize / 1'000U ) + "k";
+	const std::string typingName = "search_typing_common" + suffix;
+	bool isAnyEnabled = suite.IsEnabled( typingName );
+	for ( const SearchQuery& query : SearchQueries )
+	{
+		isAnyEnabled = isAnyEnabled || suite.IsEnabled( "search_indexed_" + std::string( query.name ) + suffix )
+			|| suite.IsEnabled( "search_scan_" + std::string( query.name ) + suffix );
+	}
+
+	if ( !isAnyEnabled )
+	{
+		return;
+	}
+
+	// Every line gets an id, so there's something that only occurs once
+	const std::vector<std::string> texts = GenerateLogTexts( 4096U );
+	auto history = std::make_unique<MessageHistory>( SearchHistorySize );
+	auto search = std::make_unique<MessageSearch>( *history );
+	std::string text{};
+	for ( size_t i = 0U; i < SearchHistorySize; i++ )
+	{
+		text = texts[i % texts.size()];
+		text.append( "id=" ).append( std::to_string( i ) );
+		history->Push( ConsoleMessage( text, i * 1000U, ConsoleMessageType::Info ) );
+	}
+
+	const uint64_t indexStart = NowMicroseconds();
+	search->Update();
+	const double indexSeconds = (NowMicroseconds() - indexStart) / 1'000'000.0;
+
+	std::vector<size_t> matches{};
+	for ( const SearchQuery& query : SearchQueries )
+	{
+		BenchmarkResult* indexed = suite.Run( "search_indexed_" + std::string( query.name ) + suffix, [&]( uint64_t iterations )
+			{
+				for ( uint64_t i = 0U; i < iterations; i++ )
+				{
+					matches.clear();
+					search->Find( query.text, matches );
+				}
+				Consume( matches.size() );
+			} );
+
+		if ( nullptr != indexed )
+		{
+			indexed->Metric( "matches", double( matches.size() ) )
+				.Metric( "query_ms", indexed->nanosecondsPerIteration / 1'000'000.0 )
+				.Metric( "index_bytes", double( search->GetMemoryUsage() ) )
+				.Metric( "history_bytes", double( history->GetMemoryUsage() ) )
+				.Metric( "index_build_ms", indexSeconds * 1000.0 );
+		}
+
+		BenchmarkResult* scan = suite.Run( "search_scan_" + std::string( query.name ) + suffix, [&]( uint64_t iterations )
+			{
+				for ( uint64_t i = 0U; i < iterations; i++ )
+				{
+					matches.clear();
+					search->Scan( query.text, matches );
+				}
+				Consume( matches.size() );
+			} );
+
+		if ( nullptr != scan )
+		{
+			scan->Metric( "matches", double( matches.size() ) )
+				.Metric( "query_ms", scan->nanosecondsPerIteration / 1'000'000.0 );
+		}
+	}
+
+	// The way queries are actually made, a keystroke at a time, narrowing down the previous matches
+	constexpr std::string_view TypedQuery = "texture";
+	BenchmarkResult* typing = suite.Run( typingName, [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				search->SetQuery( "" );
+				for ( size_t length = 1U; length <= TypedQuery.size(); length++ )
+				{
+					search->SetQuery( TypedQuery.substr( 0U, length ) );
+				}
+			}
+			Consume( search->GetNumMatches() );
+		} );
+
+	if ( nullptr != typing )
+	{
+		typing->Metric( "matches", double( search->GetNumMatches() ) )
+			.Metric( "ms_per_keystroke", typing->nanosecondsPerIteration / 1'000'000.0 / double( TypedQuery.size() ) );
+	}
+}
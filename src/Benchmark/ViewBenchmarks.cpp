@@ -0,0 +1,278 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include <deque>
+#include <unordered_map>
+#include "Benchmark.hpp"
+#include "View/ConsoleView.hpp"
+#include "View/MessageLinesNode.hpp"
+
+// A typical maximised terminal
+constexpr int ScreenWidth = 200;
+constexpr int ScreenHeight = 60;
+// Stays under the view's incoming queue capacity, so nothing gets dropped while filling
+constexpr size_t FillChunkSize = 4096U;
+// The old renderer holds an element tree for the whole history, a million lines of it take gigabytes
+constexpr size_t MaxBaselineHistorySize = 100'000U;
+
+static std::vector<ConsoleMessage> CreateMessages( const std::vector<std::string>& texts )
+{
+	std::vector<ConsoleMessage> messages{};
+	messages.reserve( texts.size() );
+	for ( size_t i = 0U; i < texts.size(); i++ )
+	{
+		messages.emplace_back( texts[i], i * 1234U, static_cast<ConsoleMessageType::Enum>( i % 6U ) );
+		messages.back().source = uint8_t( 1U + i % 4U );
+	}
+
+	return messages;
+}
+
+// The whole UI, title bar, scroller, autocomplete window and input, redrawn with nothing new to show
+static void BenchmarkFullRender( BenchmarkSuite& suite, const std::vector<ConsoleMessage>& messages, size_t historySize,
+	bool showStatistics = false )
+{
+	const std::string name = (showStatistics ? "full_render_stats_" : "full_render_") + std::to_string( historySize );
+	if ( !suite.IsEnabled( name ) )
+	{
+		return;
+	}
+
+	const size_t residentBefore = GetResidentBytes();
+
+	auto view = std::make_unique<ConsoleView>();
+	view->SetHistoryCapacity( historySize );
+	view->SetShowStatistics( showStatistics );
+	view->InitOffscreen( []( std::string_view, size_t ) {}, []( std::string_view ) {} );
+
+	Screen screen( ScreenWidth, ScreenHeight );
+
+	// Every frame drains the queue into the history, so fill it a chunk at a time
+	// The view takes the messages it's given, so it gets copies, which own nothing
+	std::vector<ConsoleMessage> batch{};
+	const auto fillStart = std::chrono::steady_clock::now();
+	for ( size_t filled = 0U; filled < historySize; filled += FillChunkSize )
+	{
+		const size_t count = std::min( FillChunkSize, historySize - filled );
+		for ( size_t i = 0U; i < count; i += messages.size() )
+		{
+			batch.clear();
+			for ( size_t j = 0U; j < std::min( messages.size(), count - i ); j++ )
+			{
+				batch.push_back( messages[j].CopyWithoutText() );
+			}
+			view->OnLog( batch.data(), batch.size() );
+		}
+		view->RenderOffscreen( screen );
+	}
+	const double fillSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - fillStart ).count();
+	const size_t residentAfter = GetResidentBytes();
+
+	BenchmarkResult* result = suite.Run( name, [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				view->RenderOffscreen( screen );
+			}
+		} );
+
+	result->Metric( "fill_ns_per_message", fillSeconds * 1'000'000'000.0 / double( historySize ) )
+		.Metric( "resident_bytes_per_message", double( residentAfter - std::min( residentBefore, residentAfter ) ) / double( historySize ) );
+}
+
+// A message the way the console drew it before MessageLinesNode, parsed anew into text elements on every frame
+static Element BaselineMessageElement( const ConsoleMessage& message )
+{
+	static std::unordered_map<char, Color> ColourMap
+	{
+		{ 'r', Color::Red },
+		{ 'o', Color::Orange1 },
+		{ 'y', Color::Yellow },
+		{ 'g', Color::GreenLight },
+		{ 'b', Color::BlueLight },
+		{ 'p', Color::Pink1 },
+		{ 'w', Color::White },
+		{ 'G', Color::GrayLight }
+	};
+
+	char currentColour = 'w';
+	Elements colouredTexts{};
+	ElementDecorator textColour = color( ColourMap[currentColour] );
+	std::string string;
+	for ( size_t i = 0; i < message.text.size(); i++ )
+	{
+		if ( message.text[i] == '$' )
+		{
+			if ( !string.empty() )
+			{
+				colouredTexts.emplace_back( text( string ) | textColour );
+				string.clear();
+			}
+
+			i++;
+			if ( i >= message.text.size() )
+			{
+				break;
+			}
+
+			currentColour = message.text[i];
+
+			auto iterator = ColourMap.find( currentColour );
+			if ( iterator == ColourMap.end() )
+			{
+				textColour = color( Color::White );
+			}
+			else
+			{
+				textColour = color( iterator->second );
+			}
+
+			i++;
+			if ( i >= message.text.size() )
+			{
+				break;
+			}
+		}
+
+		string += message.text[i];
+
+		if ( i == message.text.size() - 1 )
+		{
+			colouredTexts.emplace_back( text( string ) | textColour );
+		}
+	}
+
+	return hbox(
+		{
+			text( MessageLinesNode::GenerateTimeString( message.timeSubmitted ) ),
+			separator(),
+			text( " " ),
+			hbox( std::move( colouredTexts ) )
+		} );
+}
+
+// The whole UI as it was drawn before MessageLinesNode and the virtualised scroller,
+// every message of the history turned into elements and laid out, then framed by the scroller
+// Compare with full_render_N at the same size
+static void BenchmarkBaselineRender( BenchmarkSuite& suite, const std::vector<ConsoleMessage>& messages, size_t historySize )
+{
+	const std::string name = "full_render_baseline_" + std::to_string( historySize );
+	if ( historySize > MaxBaselineHistorySize || !suite.IsEnabled( name ) )
+	{
+		return;
+	}
+
+	// The old history kept the text as received, colour codes and all
+	std::deque<ConsoleMessage> history{};
+	while ( history.size() < historySize )
+	{
+		history.push_back( messages[history.size() % messages.size()].CopyWithoutText() );
+	}
+	history.resize( historySize );
+
+	Screen screen( ScreenWidth, ScreenHeight );
+	Element autocompleteElement = text( "" );
+	suite.Run( name, [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				Elements consoleMessageElements{};
+				for ( const ConsoleMessage& message : history )
+				{
+					consoleMessageElements.emplace_back( BaselineMessageElement( message ) );
+				}
+
+				// What the old Scroller did, scrolled all the way down
+				Element background = vbox( std::move( consoleMessageElements ) );
+				background->ComputeRequirement();
+				const int selected = background->requirement().min_y - 1;
+				Element scroller = dbox(
+					{
+						std::move( background ),
+						vbox(
+						{
+							text( L"" ) | size( HEIGHT, EQUAL, selected ),
+							text( L"" ) | focus,
+						} ),
+					} ) | vscroll_indicator | yframe | yflex;
+
+				Render( screen, vbox(
+					{
+						hbox(
+						{
+							text( "v0.1.0" ),
+							separatorLight(),
+							text( "Elegy Developer Console" ) | center | flex,
+							separatorLight(),
+							spinner( 18, i )
+						} ),
+						separatorLight(),
+						dbox(
+						{
+							vbox( { std::move( scroller ), filler() } ),
+							hbox(
+							{
+								filler(),
+								vbox( { filler() | yflex_shrink, autocompleteElement | size( WIDTH, LESS_THAN, 40 ) | size( HEIGHT, LESS_THAN, 60 ) } ),
+								filler() | size( Direction::WIDTH, Constraint::EQUAL, 8 )
+							} )
+						} ) | flex,
+						separatorLight(),
+						hbox( { text( "> " ), text( "[enter your command here]" ) | focus | size( HEIGHT, EQUAL, 1 ) } )
+					} ) | borderDouble );
+			}
+		} );
+}
+
+// ============================
+// RunViewBenchmarks
+// ============================
+void RunViewBenchmarks( BenchmarkSuite& suite, const std::vector<size_t>& historySizes )
+{
+	const std::vector<std::string> texts = GenerateLogTexts( 1024U );
+	const std::vector<ConsoleMessage> messages = CreateMessages( texts );
+
+	suite.Run( "time_string", [&]( uint64_t iterations )
+		{
+			for ( uint64_t i = 0U; i < iterations; i++ )
+			{
+				Consume( uint8_t( MessageLinesNode::GenerateTimeString( i * 7919U )[8] ) );
+			}
+		} );
+
+	// Just the message lines, one screen's worth, as the scroller asks for them
+	MessageHistory history( 16384U );
+	for ( size_t i = 0U; i < history.Capacity(); i++ )
+	{
+		history.Push( messages[i % messages.size()] );
+	}
+
+	Screen screen( ScreenWidth, ScreenHeight );
+	for ( const bool showSources : { false, true } )
+	{
+		BenchmarkResult* result = suite.Run( showSources ? "message_lines_paint_sources" : "message_lines_paint",
+			[&]( uint64_t iterations )
+			{
+				for ( uint64_t i = 0U; i < iterations; i++ )
+				{
+					const size_t first = history.Begin() + i * 97U % (history.Size() - ScreenHeight);
+					Render( screen, MessageLines( history, first, first + ScreenHeight, showSources ) );
+				}
+			} );
+
+		if ( nullptr != result )
+		{
+			result->Metric( "ns_per_line", result->nanosecondsPerIteration / double( ScreenHeight ) );
+		}
+	}
+
+	for ( const size_t historySize : historySizes )
+	{
+		BenchmarkFullRender( suite, messages, historySize );
+		BenchmarkBaselineRender( suite, messages, historySize );
+	}
+
+	// What the stats strip costs when it's shown, compare with full_render_10000
+	BenchmarkFullRender( suite, messages, 10'000U, true );
+}
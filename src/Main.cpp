@@ -7,63 +7,144 @@
 #include "View/ConsoleView.hpp"
 
 namespace chrono = std::chrono;
-namespace this_thread = std::this_thread;
 
-constexpr float UpdateInterval = 1.0f / 20.0f;
 constexpr float PingInterval = 1.0f;
 
-void Wait( float seconds )
+static chrono::time_point<chrono::steady_clock> StartupTime = chrono::steady_clock::now();
+float Now()
 {
-	this_thread::sleep_for( chrono::milliseconds( int( seconds * 1000.0f ) ) );
+	return NowMicroseconds() / 1'000'000.0f;
 }
 
-static chrono::time_point<chrono::system_clock> StartupTime;
-float Now()
+uint64_t NowMicroseconds()
 {
-	auto timeNow = chrono::system_clock::now();
-	return chrono::duration_cast<chrono::microseconds>(timeNow - StartupTime).count() / 1'000'000.0f;
+	// Steady, so the times can't jump backwards and wrap around when the wall clock is adjusted
+	auto timeNow = chrono::steady_clock::now();
+	return chrono::duration_cast<chrono::microseconds>(timeNow - StartupTime).count();
 }
 
-int main()
+// Parses e.g. "-history 4096" out of the command line
+size_t ParseHistoryCapacity( int argc, char** argv )
 {
-	StartupTime = chrono::system_clock::now();
+	for ( int i = 1; i < argc - 1; i++ )
+	{
+		if ( std::string_view( argv[i] ) == "-history" )
+		{
+			const long long capacity = std::atoll( argv[i + 1] );
+			if ( capacity > 0 )
+			{
+				return static_cast<size_t>( capacity );
+			}
+		}
+	}
+
+	return MessageHistory::DefaultCapacity;
+}
+
+// Parses e.g. "-frame-budget 4" out of the command line, in milliseconds
+float ParseFrameBudget( int argc, char** argv )
+{
+	for ( int i = 1; i < argc - 1; i++ )
+	{
+		if ( std::string_view( argv[i] ) == "-frame-budget" )
+		{
+			const float budget = float( std::atof( argv[i + 1] ) );
+			if ( budget > 0.0f )
+			{
+				return budget;
+			}
+		}
+	}
+
+	return FramePacer::DefaultBudgetMicroseconds / 1000.0f;
+}
+
+// Parses e.g. "-connect 127.0.0.1:23005 -connect 127.0.0.1:23006" out of the command line
+// Without any, connects to a single engine on this machine
+std::vector<std::string> ParseEndpoints( int argc, char** argv )
+{
+	std::vector<std::string> endpoints;
+	for ( int i = 1; i < argc - 1; i++ )
+	{
+		if ( std::string_view( argv[i] ) == "-connect" )
+		{
+			endpoints.emplace_back( argv[i + 1] );
+		}
+	}
+
+	if ( endpoints.empty() )
+	{
+		endpoints.emplace_back( "127.0.0.1:23005" );
+	}
+
+	return endpoints;
+}
+
+// Checks for a flag like "-stats" on the command line
+bool HasArgument( int argc, char** argv, std::string_view argument )
+{
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( argv[i] == argument )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int main( int argc, char** argv )
+{
+	StartupTime = chrono::steady_clock::now();
 
 	ConsoleView view{};
 	Network net{};
 
-	view.Init( [&]( std::string_view command )
+	const std::vector<std::string> endpoints = ParseEndpoints( argc, argv );
+
+	view.SetHistoryCapacity( ParseHistoryCapacity( argc, argv ) );
+	view.SetNumEngines( endpoints.size() );
+	view.SetFrameBudget( ParseFrameBudget( argc, argv ) );
+	// "-reliable-logs" keeps engines from sending Verbose and Developer messages unreliably
+	net.SetAllowUnreliableLogs( !HasArgument( argc, argv, "-reliable-logs" ) );
+	view.SetShowStatistics( HasArgument( argc, argv, "-stats" ) );
+	view.SetStatisticsSource( [&]
+		{
+			return net.GetStatistics();
+		} );
+
+	view.Init( [&]( std::string_view command, size_t target )
 		{
-			net.SubmitCommand( command );
+			net.SubmitCommand( command, target );
 		},
-		
-		[&]( std::string_view command )
+
+		[&]( std::string_view prefix )
 		{
-			net.RequestAutocompleteUpdate( command );
+			net.RequestAutocomplete( prefix );
 		} );
 
-	Wait( 0.1f );
-
-	const bool result = net.Init( [&]( const ConsoleMessage& message )
+	const bool result = net.Init( endpoints, [&]( ConsoleMessage* messages, size_t numMessages )
 		{
-			view.OnLog( message );
+			view.OnLog( messages, numMessages );
 		},
 
-		[&]( const std::vector<std::string>& autocompleteStrings )
+		[&]( AutocompleteRecords&& records, uint8_t source, bool isFullCatalogue )
 		{
-			view.SetAutocompleteBuffer( autocompleteStrings );
+			view.OnAutocompleteCatalogue( std::move( records ), source, isFullCatalogue );
 		} );
 
+	// The reason was logged to the view, which takes its screen along when it shuts down
 	if ( !result )
 	{
-		Wait( 0.5f );
 		view.Shutdown();
+		printf( "[DevConsoleApp] Failed to initialise networking\n" );
+		fflush( stdout );
 		return -1;
 	}
 
-	while ( view.OnUpdate( UpdateInterval ) )
-	{
-		Wait( UpdateInterval );
-	}
+	// Returns once the user quits
+	view.Run();
 
 	net.Shutdown();
 	view.OnLog( { "$y[DevConsoleApp] $gGracefully shutting down..." } );
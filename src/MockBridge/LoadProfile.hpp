@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// LoadProfile
+// 
+// What kind of traffic the mock bridge generates
+// ============================
+struct LoadProfile
+{
+	// Indexed by ConsoleMessageType
+	static constexpr size_t NumMessageTypes = 6U;
+
+	uint16_t port{ Network::DefaultPort };
+
+	// Spread evenly over time
+	float messagesPerSecond{ 1000.0f };
+	// Every burstInterval seconds, burstSize messages go out at once, on top of the steady rate
+	size_t burstSize{ 0U };
+	float burstInterval{ 1.0f };
+
+	// Text lengths are drawn uniformly from this range, not counting colour codes
+	size_t minLength{ 16U };
+	size_t maxLength{ 120U };
+	// Relative weights of Info, Developer, Verbose, Warning, Error and Fatal
+	std::array<float, NumMessageTypes> typeWeights{ 60.0f, 10.0f, 20.0f, 6.0f, 3.0f, 1.0f };
+	// Chance of a colour code in front of each word
+	float colourCodeDensity{ 0.05f };
+
+	// Most messages in one packet
+	size_t maxBatchSize{ 64U };
+	// Whether to accept the console's offer of unreliable Verbose and Developer messages
+	bool allowUnreliable{ true };
+	// Newest protocol version to speak, Legacy acts like a bridge from before the handshake
+	ProtocolVersion::Enum maxProtocolVersion{ ProtocolVersion::Latest };
+
+	// Size of the fake cvar/command catalogue
+	size_t numCatalogueEntries{ 500U };
+
+	// How long to run for, 0 runs until the process is killed
+	float duration{ 0.0f };
+	uint32_t seed{ 1U };
+};
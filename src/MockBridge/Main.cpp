@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#ifdef WIN32
+#pragma		comment(lib, "Winmm.lib")
+#pragma		comment(lib, "Ws2_32.lib")
+#endif
+
+#include "Precompiled.hpp"
+#include <cstdio>
+#include "MockBridge.hpp"
+
+namespace chrono = std::chrono;
+namespace this_thread = std::this_thread;
+
+constexpr float ReportInterval = 1.0f;
+
+void Wait( float seconds )
+{
+	this_thread::sleep_for( chrono::milliseconds( int( seconds * 1000.0f ) ) );
+}
+
+static chrono::time_point<chrono::steady_clock> StartupTime = chrono::steady_clock::now();
+float Now()
+{
+	return NowMicroseconds() / 1'000'000.0f;
+}
+
+uint64_t NowMicroseconds()
+{
+	return chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now() - StartupTime ).count();
+}
+
+void PrintUsage()
+{
+	printf( "Elegy.DevConsoleMockBridge: pretends to be an Elegy Engine instance for the developer console\n"
+		"  -port N            port to listen on (23005)\n"
+		"  -rate N            messages per second (1000)\n"
+		"  -burst N:S         N extra messages at once every S seconds (off)\n"
+		"  -size MIN:MAX      message length range (16:120)\n"
+		"  -types I,D,V,W,E,F weights of Info, Developer, Verbose, Warning, Error, Fatal (60,10,20,6,3,1)\n"
+		"  -colours F         chance of a colour code before each word (0.05)\n"
+		"  -batch N           most messages per packet (64)\n"
+		"  -reliable          don't accept unreliable Verbose/Developer messages\n"
+		"  -legacy            speak protocol version 1, no handshake\n"
+		"  -cvars N           catalogue size (500)\n"
+		"  -duration S        quit after S seconds (run forever)\n"
+		"  -seed N            random seed (1)\n"
+		"Commands sent from the console: 'mock_rate N', 'mock_burst N'\n" );
+}
+
+// Returns false on anything it doesn't understand
+bool ParseLoadProfile( int argc, char** argv, LoadProfile& profile )
+{
+	for ( int i = 1; i < argc; i++ )
+	{
+		const std::string_view argument = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if ( argument == "-reliable" )
+		{
+			profile.allowUnreliable = false;
+			continue;
+		}
+		if ( argument == "-legacy" )
+		{
+			profile.maxProtocolVersion = ProtocolVersion::Legacy;
+			continue;
+		}
+
+		// Everything else takes a value
+		if ( nullptr == value )
+		{
+			return false;
+		}
+		i++;
+
+		if ( argument == "-port" )
+		{
+			profile.port = uint16_t( std::atoi( value ) );
+		}
+		else if ( argument == "-rate" )
+		{
+			profile.messagesPerSecond = float( std::atof( value ) );
+		}
+		else if ( argument == "-burst" )
+		{
+			unsigned burstSize = 0U;
+			if ( sscanf( value, "%u:%f", &burstSize, &profile.burstInterval ) != 2 )
+			{
+				return false;
+			}
+			profile.burstSize = burstSize;
+		}
+		else if ( argument == "-size" )
+		{
+			unsigned minLength = 0U;
+			unsigned maxLength = 0U;
+			if ( sscanf( value, "%u:%u", &minLength, &maxLength ) != 2 )
+			{
+				return false;
+			}
+			profile.minLength = minLength;
+			profile.maxLength = maxLength;
+		}
+		else if ( argument == "-types" )
+		{
+			auto& weights = profile.typeWeights;
+			if ( sscanf( value, "%f,%f,%f,%f,%f,%f", &weights[0], &weights[1], &weights[2], &weights[3], &weights[4], &weights[5] ) != 6 )
+			{
+				return false;
+			}
+		}
+		else if ( argument == "-colours" )
+		{
+			profile.colourCodeDensity = float( std::atof( value ) );
+		}
+		else if ( argument == "-batch" )
+		{
+			profile.maxBatchSize = size_t( std::max( 1, std::atoi( value ) ) );
+		}
+		else if ( argument == "-cvars" )
+		{
+			profile.numCatalogueEntries = size_t( std::max( 0, std::atoi( value ) ) );
+		}
+		else if ( argument == "-duration" )
+		{
+			profile.duration = float( std::atof( value ) );
+		}
+		else if ( argument == "-seed" )
+		{
+			profile.seed = uint32_t( std::atoll( value ) );
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Percentile of the latencies in microseconds, reorders them
+uint32_t GetPercentile( std::vector<uint32_t>& latencies, float percentile )
+{
+	if ( latencies.empty() )
+	{
+		return 0U;
+	}
+
+	const size_t index = std::min( latencies.size() - 1U, size_t( latencies.size() * percentile ) );
+	std::nth_element( latencies.begin(), latencies.begin() + index, latencies.end() );
+	return latencies[index];
+}
+
+void PrintStatistics( const char* label, MockBridge::Statistics& statistics, float seconds )
+{
+	const uint32_t median = GetPercentile( statistics.acknowledgeLatencies, 0.5f );
+	const uint32_t p99 = GetPercentile( statistics.acknowledgeLatencies, 0.99f );
+	const uint32_t maximum = statistics.acknowledgeLatencies.empty() ? 0U
+		: *std::max_element( statistics.acknowledgeLatencies.begin(), statistics.acknowledgeLatencies.end() );
+
+	printf( "[%s] consoles %zu | sent %.0f msg/s %.1f KiB/s | acked %.0f msg/s, latency p50 %.2f ms p99 %.2f ms max %.2f ms"
+		" | rtt %u ms | commands %llu, autocomplete %llu\n",
+		label, statistics.numClients,
+		statistics.messagesSent / seconds, statistics.bytesSent / 1024.0f / seconds,
+		statistics.messagesAcknowledged / seconds, median / 1000.0f, p99 / 1000.0f, maximum / 1000.0f,
+		statistics.roundTripTime,
+		(unsigned long long)statistics.commandsReceived, (unsigned long long)statistics.autocompleteRequests );
+	fflush( stdout );
+}
+
+int main( int argc, char** argv )
+{
+	LoadProfile profile{};
+	if ( !ParseLoadProfile( argc, argv, profile ) )
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	if ( enet_initialize() < 0 )
+	{
+		printf( "Failed to initialise ENet\n" );
+		return -1;
+	}
+
+	MockBridge bridge{};
+	if ( !bridge.Init( profile ) )
+	{
+		printf( "Failed to listen on port %u\n", unsigned( profile.port ) );
+		enet_deinitialize();
+		return -1;
+	}
+
+	printf( "Listening on port %u, %.0f messages per second\n", unsigned( profile.port ), profile.messagesPerSecond );
+
+	// Per report interval, and over the whole run
+	MockBridge::Statistics total{};
+	float lastReportTime = Now();
+	const float startTime = lastReportTime;
+	bool isRunning = true;
+	while ( isRunning )
+	{
+		isRunning = bridge.Update( 10U );
+
+		const float now = Now();
+		if ( now - lastReportTime < ReportInterval && isRunning )
+		{
+			continue;
+		}
+
+		MockBridge::Statistics statistics = bridge.TakeStatistics();
+		PrintStatistics( "mock", statistics, now - lastReportTime );
+		lastReportTime = now;
+
+		total.numClients = statistics.numClients;
+		total.messagesSent += statistics.messagesSent;
+		total.bytesSent += statistics.bytesSent;
+		total.messagesAcknowledged += statistics.messagesAcknowledged;
+		total.acknowledgeLatencies.insert( total.acknowledgeLatencies.end(),
+			statistics.acknowledgeLatencies.begin(), statistics.acknowledgeLatencies.end() );
+		total.commandsReceived += statistics.commandsReceived;
+		total.autocompleteRequests += statistics.autocompleteRequests;
+		total.roundTripTime = statistics.roundTripTime;
+	}
+
+	PrintStatistics( "total", total, Now() - startTime );
+
+	bridge.Shutdown();
+	enet_deinitialize();
+	return 0;
+}
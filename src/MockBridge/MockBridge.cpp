@@ -0,0 +1,652 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include <cmath>
+#include "MockBridge.hpp"
+#include "Network/PacketReader.hpp"
+#include "Network/PacketWriter.hpp"
+
+namespace
+{
+	constexpr std::string_view Words[]
+	{
+		"entity", "spawned", "at", "origin", "loading", "map", "texture", "missing", "shader",
+		"compiled", "in", "ms", "player", "connected", "from", "frame", "took", "physics", "step",
+		"audio", "buffer", "underrun", "render", "target", "resized", "to", "cvar", "changed"
+	};
+
+	constexpr char ColourCodes[] = "roygbpwG";
+}
+
+// ============================
+// MockBridge::Init
+// ============================
+bool MockBridge::Init( const LoadProfile& loadProfile )
+{
+	profile = loadProfile;
+	random.seed( profile.seed );
+	typeDistribution = std::discrete_distribution<int>( profile.typeWeights.begin(), profile.typeWeights.end() );
+	lengthDistribution = std::uniform_int_distribution<size_t>( profile.minLength, std::max( profile.minLength, profile.maxLength ) );
+
+	// Only consoles on the same machine can connect, the mock is a test tool and has no business being reachable
+	ENetAddress address{};
+	enet_address_set_host_ip( &address, "127.0.0.1" );
+	address.port = profile.port;
+
+	host = enet_host_create( &address, 32, NetworkChannel::Count, 0, 0 );
+	if ( nullptr == host )
+	{
+		return false;
+	}
+
+	clients.resize( host->peerCount );
+	GenerateCatalogue();
+
+	startTime = NowMicroseconds();
+	rateStartTime = startTime;
+	lastBurstTime = startTime;
+	return true;
+}
+
+// ============================
+// MockBridge::Shutdown
+// ============================
+void MockBridge::Shutdown()
+{
+	// Say goodbye like the engine does, so the consoles go back to waiting for it
+	const uint8_t goodbye = 'X';
+	for ( size_t i = 0U; i < host->peerCount; i++ )
+	{
+		if ( clients[i].isConnected )
+		{
+			enet_peer_send( &host->peers[i], NetworkChannel::Logs, enet_packet_create( &goodbye, 1U, ENET_PACKET_FLAG_RELIABLE ) );
+		}
+	}
+
+	enet_host_flush( host );
+	enet_host_destroy( host );
+	host = nullptr;
+}
+
+// ============================
+// MockBridge::Update
+// ============================
+bool MockBridge::Update( uint32_t timeoutMilliseconds )
+{
+	ENetEvent netEvent{};
+	while ( enet_host_service( host, &netEvent, 0 ) > 0 )
+	{
+		switch ( netEvent.type )
+		{
+		case ENET_EVENT_TYPE_CONNECT: OnConnect( netEvent.peer, netEvent.data ); break;
+		case ENET_EVENT_TYPE_DISCONNECT: GetClient( netEvent.peer ).isConnected = false; break;
+		case ENET_EVENT_TYPE_RECEIVE: OnReceive( netEvent.peer, netEvent.packet ); break;
+		default: break;
+		}
+	}
+
+	const size_t numDue = GetNumDueMessages();
+	for ( size_t i = 0U; i < numDue; i++ )
+	{
+		GenerateMessage();
+		if ( generatedMessages.size() >= profile.maxBatchSize )
+		{
+			SendGeneratedMessages();
+		}
+	}
+	SendGeneratedMessages();
+
+	// Wait for the consoles, at most until the next message is due, but at least a millisecond,
+	// so high rates send a few messages per wakeup instead of spinning
+	const uint64_t now = NowMicroseconds();
+	const uint64_t nextDueTime = GetNextDueTime();
+	if ( nextDueTime != UINT64_MAX )
+	{
+		const uint64_t untilDue = nextDueTime > now ? (nextDueTime - now + 999U) / 1000U : 0U;
+		timeoutMilliseconds = uint32_t( std::max<uint64_t>( std::min<uint64_t>( untilDue, timeoutMilliseconds ), 1U ) );
+	}
+
+	enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
+	enet_socket_wait( host->socket, &condition, timeoutMilliseconds );
+
+	return profile.duration <= 0.0f || NowMicroseconds() - startTime < uint64_t( profile.duration * 1'000'000.0f );
+}
+
+// ============================
+// MockBridge::TakeStatistics
+// ============================
+MockBridge::Statistics MockBridge::TakeStatistics()
+{
+	Statistics result = std::move( statistics );
+	statistics = {};
+
+	uint32_t totalRoundTripTime = 0U;
+	for ( size_t i = 0U; i < host->peerCount; i++ )
+	{
+		if ( clients[i].isConnected )
+		{
+			result.numClients++;
+			totalRoundTripTime += host->peers[i].roundTripTime;
+		}
+	}
+
+	if ( result.numClients > 0U )
+	{
+		result.roundTripTime = totalRoundTripTime / uint32_t( result.numClients );
+	}
+
+	return result;
+}
+
+// ============================
+// MockBridge::OnConnect
+// ============================
+void MockBridge::OnConnect( ENetPeer* peer, uint32_t connectData )
+{
+	Client& client = GetClient( peer );
+	client = {};
+	client.isConnected = true;
+	client.protocolVersion = ProtocolVersion::Legacy;
+
+	// Consoles from before the handshake send 0 here, and wouldn't know what to do with an 'H'
+	const uint32_t offeredVersion = connectData >> ConnectFlag::VersionShift;
+	if ( offeredVersion < ProtocolVersion::Varint || profile.maxProtocolVersion < ProtocolVersion::Varint )
+	{
+		return;
+	}
+
+	client.protocolVersion = static_cast<ProtocolVersion::Enum>( std::min<uint32_t>( offeredVersion, profile.maxProtocolVersion ) );
+	client.isUnreliableAllowed = profile.allowUnreliable && (connectData & ConnectFlag::UnreliableLogs);
+
+	packetBytes.clear();
+	PacketWriter writer( packetBytes );
+	writer.WriteByte( 'H' );
+	writer.WriteVarint( client.protocolVersion );
+	writer.WriteVarint( client.isUnreliableAllowed ? ConnectFlag::UnreliableLogs : 0U );
+
+	enet_peer_send( peer, NetworkChannel::Commands, enet_packet_create( packetBytes.data(), packetBytes.size(), ENET_PACKET_FLAG_RELIABLE ) );
+}
+
+// ============================
+// MockBridge::OnReceive
+// ============================
+void MockBridge::OnReceive( ENetPeer* peer, ENetPacket* packet )
+{
+	if ( packet->dataLength > 0U )
+	{
+		switch ( packet->data[0] )
+		{
+		case 'C': HandleCommands( peer, packet ); break;
+		case 'L': HandleCatalogueRequest( peer ); break;
+		case 'A': HandleAutocompleteRequest( peer, packet ); break;
+		default: break;
+		}
+	}
+
+	enet_packet_destroy( packet );
+}
+
+// ============================
+// MockBridge::GetClient
+// ============================
+MockBridge::Client& MockBridge::GetClient( const ENetPeer* peer )
+{
+	return clients[peer - host->peers];
+}
+
+// ============================
+// MockBridge::HandleCommands
+// 
+// A packet holds one or more records of:
+// 'C'
+// version 1: byte, version 2: varint: command length
+// bytes: command
+// ============================
+void MockBridge::HandleCommands( ENetPeer* peer, ENetPacket* packet )
+{
+	const ProtocolVersion::Enum version = GetClient( peer ).protocolVersion;
+	PacketReader reader( packet->data, packet->dataLength );
+
+	while ( !reader.IsAtEnd() )
+	{
+		uint8_t recordType;
+		uint64_t length;
+		std::string_view command;
+		if ( !reader.ReadByte( recordType ) || recordType != 'C' )
+		{
+			return;
+		}
+
+		if ( version == ProtocolVersion::Legacy )
+		{
+			uint8_t legacyLength;
+			if ( !reader.ReadByte( legacyLength ) )
+			{
+				return;
+			}
+			length = legacyLength;
+		}
+		else if ( !reader.ReadVarint( length ) )
+		{
+			return;
+		}
+
+		if ( !reader.ReadString( length, command ) )
+		{
+			return;
+		}
+
+		statistics.commandsReceived++;
+		ExecuteCommand( peer, command );
+	}
+}
+
+// ============================
+// MockBridge::ExecuteCommand
+// ============================
+void MockBridge::ExecuteCommand( ENetPeer* peer, std::string_view command )
+{
+	// The engine echoes every command, the reply goes back on the command channel
+	SendReply( peer, NetworkChannel::Commands, std::string( "] " ).append( command ) );
+
+	// A couple of commands to change the load while it's running
+	constexpr std::string_view RateCommand = "mock_rate ";
+	constexpr std::string_view BurstCommand = "mock_burst ";
+	if ( command.substr( 0, RateCommand.size() ) == RateCommand )
+	{
+		profile.messagesPerSecond = std::max( 0.0f, float( std::atof( std::string( command.substr( RateCommand.size() ) ).c_str() ) ) );
+		rateStartTime = NowMicroseconds();
+		numRateMessages = 0U;
+		SendReply( peer, NetworkChannel::Commands, "$gRate is now " + std::to_string( int( profile.messagesPerSecond ) ) + " messages per second" );
+	}
+	else if ( command.substr( 0, BurstCommand.size() ) == BurstCommand )
+	{
+		profile.burstSize = size_t( std::max( 0, std::atoi( std::string( command.substr( BurstCommand.size() ) ).c_str() ) ) );
+		SendReply( peer, NetworkChannel::Commands, "$gBursts are now " + std::to_string( profile.burstSize ) + " messages" );
+	}
+}
+
+// ============================
+// MockBridge::HandleCatalogueRequest
+// 
+// Replies with an 'L' packet:
+// varint: number of entries
+// for each entry:
+//     varint: string length
+//     bytes: string, cvar_name#flags&value
+// ============================
+void MockBridge::HandleCatalogueRequest( ENetPeer* peer )
+{
+	packetBytes.clear();
+	PacketWriter writer( packetBytes );
+	writer.WriteByte( 'L' );
+	writer.WriteVarint( catalogueNames.size() );
+	for ( size_t i = 0U; i < catalogueNames.size(); i++ )
+	{
+		WriteCatalogueEntry( i, packetBytes );
+	}
+
+	enet_peer_send( peer, NetworkChannel::Autocomplete, enet_packet_create( packetBytes.data(), packetBytes.size(), ENET_PACKET_FLAG_RELIABLE ) );
+}
+
+// ============================
+// MockBridge::HandleAutocompleteRequest
+// 
+// 'A'
+// varint: request id
+// varint: prefix length
+// bytes: prefix
+// 
+// Replies with an 'a' packet: the request id, then the same as an 'L' packet
+// ============================
+void MockBridge::HandleAutocompleteRequest( ENetPeer* peer, ENetPacket* packet )
+{
+	PacketReader reader( packet->data + 1, packet->dataLength - 1 );
+	uint64_t requestId;
+	uint64_t length;
+	std::string_view prefix;
+	if ( !reader.ReadVarint( requestId ) || !reader.ReadVarint( length ) || !reader.ReadString( length, prefix ) )
+	{
+		return;
+	}
+
+	statistics.autocompleteRequests++;
+
+	// The names are sorted, so the matches are all next to each other
+	const auto first = std::lower_bound( catalogueNames.begin(), catalogueNames.end(), prefix,
+		[]( const std::string& name, std::string_view value )
+		{
+			return std::string_view( name ) < value;
+		} );
+
+	auto last = first;
+	while ( last != catalogueNames.end() && std::string_view( *last ).substr( 0, prefix.size() ) == prefix )
+	{
+		last++;
+	}
+
+	packetBytes.clear();
+	PacketWriter writer( packetBytes );
+	writer.WriteByte( 'a' );
+	writer.WriteVarint( requestId );
+	writer.WriteVarint( size_t( last - first ) );
+	for ( auto it = first; it != last; it++ )
+	{
+		WriteCatalogueEntry( size_t( it - catalogueNames.begin() ), packetBytes );
+	}
+
+	enet_peer_send( peer, NetworkChannel::Autocomplete, enet_packet_create( packetBytes.data(), packetBytes.size(), ENET_PACKET_FLAG_RELIABLE ) );
+}
+
+// ============================
+// MockBridge::GenerateCatalogue
+// ============================
+void MockBridge::GenerateCatalogue()
+{
+	catalogueNames.clear();
+	for ( size_t i = 0U; i < profile.numCatalogueEntries; i++ )
+	{
+		// Grouped under a handful of prefixes, like real cvars are
+		const std::string_view group = Words[i % std::size( Words )];
+		catalogueNames.push_back( std::string( group ).append( "_" ).append( std::to_string( i ) ) );
+	}
+
+	std::sort( catalogueNames.begin(), catalogueNames.end() );
+}
+
+// ============================
+// MockBridge::WriteCatalogueEntry
+// ============================
+void MockBridge::WriteCatalogueEntry( size_t index, std::vector<uint8_t>& bytes )
+{
+	// Every 10th entry is a command, every 7th cvar is read-only
+	std::string entry = catalogueNames[index];
+	if ( index % 10U == 0U )
+	{
+		entry.append( "#c&" );
+	}
+	else
+	{
+		entry.append( index % 7U == 0U ? "#r&" : "#&" );
+		// Values keep changing, so refreshing them shows something
+		entry.append( std::to_string( random() % 1000U ) );
+	}
+
+	PacketWriter writer( bytes );
+	writer.WriteVarint( entry.size() );
+	writer.WriteString( entry );
+}
+
+// ============================
+// MockBridge::GetNumDueMessages
+// ============================
+size_t MockBridge::GetNumDueMessages()
+{
+	const uint64_t now = NowMicroseconds();
+	size_t numDue = 0U;
+
+	// Going by the total since the rate was set, so rounding doesn't add up over time
+	const uint64_t numExpected = uint64_t( double( now - rateStartTime ) * profile.messagesPerSecond / 1'000'000.0 );
+	if ( numExpected > numRateMessages )
+	{
+		numDue += size_t( numExpected - numRateMessages );
+		numRateMessages = numExpected;
+	}
+
+	if ( profile.burstSize > 0U && now - lastBurstTime >= uint64_t( profile.burstInterval * 1'000'000.0f ) )
+	{
+		numDue += profile.burstSize;
+		lastBurstTime = now;
+	}
+
+	return numDue;
+}
+
+// ============================
+// MockBridge::GetNextDueTime
+// ============================
+uint64_t MockBridge::GetNextDueTime() const
+{
+	uint64_t nextDueTime = UINT64_MAX;
+	if ( profile.messagesPerSecond > 0.0f )
+	{
+		nextDueTime = rateStartTime + uint64_t( std::ceil( double( numRateMessages + 1U ) * 1'000'000.0 / profile.messagesPerSecond ) );
+	}
+
+	if ( profile.burstSize > 0U )
+	{
+		nextDueTime = std::min( nextDueTime, lastBurstTime + uint64_t( profile.burstInterval * 1'000'000.0f ) );
+	}
+
+	return nextDueTime;
+}
+
+// ============================
+// MockBridge::GenerateMessage
+// ============================
+void MockBridge::GenerateMessage()
+{
+	std::uniform_real_distribution<float> chance( 0.0f, 1.0f );
+
+	GeneratedMessage message{};
+	message.type = static_cast<ConsoleMessageType::Enum>( typeDistribution( random ) );
+	message.timeMicroseconds = NowMicroseconds() - startTime;
+	message.textOffset = messageText.size();
+
+	// Words until the length is reached, colour codes don't count towards it
+	const size_t length = lengthDistribution( random );
+	size_t visibleLength = 0U;
+	while ( visibleLength < length )
+	{
+		if ( chance( random ) < profile.colourCodeDensity )
+		{
+			messageText.push_back( '$' );
+			messageText.push_back( ColourCodes[random() % (std::size( ColourCodes ) - 1U)] );
+		}
+
+		const std::string_view word = Words[random() % std::size( Words )];
+		const size_t wordLength = std::min( word.size(), length - visibleLength );
+		messageText.append( word.substr( 0U, wordLength ) );
+		visibleLength += wordLength;
+
+		if ( visibleLength < length )
+		{
+			messageText.push_back( ' ' );
+			visibleLength++;
+		}
+	}
+
+	message.textLength = messageText.size() - message.textOffset;
+	generatedMessages.push_back( message );
+}
+
+// ============================
+// MockBridge::SendGeneratedMessages
+// ============================
+void MockBridge::SendGeneratedMessages()
+{
+	if ( generatedMessages.empty() )
+	{
+		return;
+	}
+
+	const auto isUnreliableType = []( ConsoleMessageType::Enum type )
+	{
+		return type == ConsoleMessageType::Developer || type == ConsoleMessageType::Verbose;
+	};
+
+	for ( size_t i = 0U; i < host->peerCount; i++ )
+	{
+		Client& client = clients[i];
+		ENetPeer* peer = &host->peers[i];
+		if ( !client.isConnected )
+		{
+			continue;
+		}
+
+		if ( !client.isUnreliableAllowed )
+		{
+			packetBytes.clear();
+			packetBytes.push_back( 'B' );
+			const uint32_t numMessages = WriteBatch( packetBytes, []( const GeneratedMessage& ) { return true; } );
+			SendLogPacket( peer, NetworkChannel::Logs, packetBytes, numMessages, true );
+			continue;
+		}
+
+		// Everything important stays reliable
+		packetBytes.clear();
+		packetBytes.push_back( 'B' );
+		const uint32_t numReliable = WriteBatch( packetBytes, [&]( const GeneratedMessage& message )
+			{
+				return !isUnreliableType( message.type );
+			} );
+
+		if ( numReliable > 0U )
+		{
+			SendLogPacket( peer, NetworkChannel::Logs, packetBytes, numReliable, true );
+		}
+
+		// One stream per unreliable type, so a gap tells which kind of messages went missing
+		for ( const ConsoleMessageType::Enum stream : { ConsoleMessageType::Developer, ConsoleMessageType::Verbose } )
+		{
+			packetBytes.clear();
+			PacketWriter writer( packetBytes );
+			writer.WriteByte( 'U' );
+			writer.WriteByte( uint8_t( stream ) );
+			writer.WriteVarint( client.sequences[stream] );
+			const uint32_t numMessages = WriteBatch( packetBytes, [&]( const GeneratedMessage& message )
+				{
+					return message.type == stream;
+				} );
+
+			if ( numMessages > 0U )
+			{
+				client.sequences[stream] += numMessages;
+				SendLogPacket( peer, NetworkChannel::UnreliableLogs, packetBytes, numMessages, false );
+			}
+		}
+	}
+
+	generatedMessages.clear();
+	messageText.clear();
+}
+
+// ============================
+// MockBridge::WriteBatch
+// 
+// varint: number of messages
+// varint: time of the first message, in microseconds
+// for each message:
+//     byte: message type
+//     varint: microseconds since the previous message
+//     varint: text length
+//     bytes: text
+// ============================
+template<typename FilterFn>
+uint32_t MockBridge::WriteBatch( std::vector<uint8_t>& bytes, FilterFn filter ) const
+{
+	uint32_t numMessages = 0U;
+	uint64_t firstTime = 0U;
+	for ( const GeneratedMessage& message : generatedMessages )
+	{
+		if ( filter( message ) )
+		{
+			firstTime = numMessages == 0U ? message.timeMicroseconds : firstTime;
+			numMessages++;
+		}
+	}
+
+	PacketWriter writer( bytes );
+	writer.WriteVarint( numMessages );
+	writer.WriteVarint( firstTime );
+
+	uint64_t previousTime = firstTime;
+	for ( const GeneratedMessage& message : generatedMessages )
+	{
+		if ( !filter( message ) )
+		{
+			continue;
+		}
+
+		writer.WriteByte( uint8_t( message.type ) );
+		writer.WriteVarint( message.timeMicroseconds - previousTime );
+		writer.WriteVarint( message.textLength );
+		writer.WriteString( std::string_view( messageText ).substr( message.textOffset, message.textLength ) );
+		previousTime = message.timeMicroseconds;
+	}
+
+	return numMessages;
+}
+
+// ============================
+// MockBridge::SendLogPacket
+// ============================
+void MockBridge::SendLogPacket( ENetPeer* peer, NetworkChannel::Enum channel, const std::vector<uint8_t>& bytes,
+	uint32_t numMessages, bool reliable )
+{
+	ENetPacket* packet = enet_packet_create( bytes.data(), bytes.size(), reliable ? ENET_PACKET_FLAG_RELIABLE : 0 );
+	if ( reliable )
+	{
+		// Reliable packets are freed once they're acknowledged
+		packet->userData = new PacketRecord{ this, NowMicroseconds(), numMessages };
+		packet->freeCallback = &MockBridge::OnLogPacketFreed;
+	}
+
+	statistics.messagesSent += numMessages;
+	statistics.bytesSent += bytes.size();
+
+	if ( enet_peer_send( peer, channel, packet ) < 0 )
+	{
+		enet_packet_destroy( packet );
+	}
+}
+
+// ============================
+// MockBridge::SendReply
+// 
+// 'M' packet, see Network::DecodeMessagePacket
+// ============================
+void MockBridge::SendReply( ENetPeer* peer, NetworkChannel::Enum channel, std::string_view text )
+{
+	const uint64_t time = NowMicroseconds() - startTime;
+
+	packetBytes.clear();
+	PacketWriter writer( packetBytes );
+	writer.WriteByte( 'M' );
+	writer.WriteByte( ConsoleMessageType::Info );
+	if ( GetClient( peer ).protocolVersion == ProtocolVersion::Legacy )
+	{
+		text = text.substr( 0U, UINT16_MAX );
+		writer.WriteFloat( time / 1'000'000.0f );
+		writer.WriteUint16( uint16_t( text.size() ) );
+	}
+	else
+	{
+		writer.WriteVarint( time );
+		writer.WriteVarint( text.size() );
+	}
+	writer.WriteString( text );
+
+	enet_peer_send( peer, channel, enet_packet_create( packetBytes.data(), packetBytes.size(), ENET_PACKET_FLAG_RELIABLE ) );
+}
+
+// ============================
+// MockBridge::OnLogPacketFreed
+// ============================
+void ENET_CALLBACK MockBridge::OnLogPacketFreed( ENetPacket* packet )
+{
+	auto* record = static_cast<PacketRecord*>( packet->userData );
+	MockBridge& bridge = *record->bridge;
+
+	// Packets that are still queued when a console disconnects are freed too, those don't count
+	// ENet only flags a reliable packet as sent once it's acknowledged, the ones thrown out with
+	// the queues don't get the flag, even though the peer may still count as connected by then
+	if ( (packet->flags & ENET_PACKET_FLAG_SENT) != 0U )
+	{
+		bridge.statistics.messagesAcknowledged += record->numMessages;
+		bridge.statistics.acknowledgeLatencies.push_back( uint32_t( std::min<uint64_t>( NowMicroseconds() - record->timeSent, UINT32_MAX ) ) );
+	}
+
+	delete record;
+}
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <random>
+#include "Network/Network.hpp"
+#include "LoadProfile.hpp"
+
+// ============================
+// MockBridge
+// 
+// Stands in for an Elegy Engine instance running the DevConsole bridge plugin
+// Speaks the bridge protocol to any number of console apps, generates log traffic
+// according to a LoadProfile, and answers commands and autocomplete requests
+// ============================
+class MockBridge final
+{
+public:
+	// Everything counted since the last call to TakeStatistics
+	struct Statistics
+	{
+		size_t numClients{ 0U };
+		uint64_t messagesSent{ 0U };
+		uint64_t bytesSent{ 0U };
+		// Reliable messages the console has acknowledged, i.e. its network thread took them
+		uint64_t messagesAcknowledged{ 0U };
+		// From sending a reliable packet until every console acknowledged it, in microseconds
+		std::vector<uint32_t> acknowledgeLatencies{};
+		uint64_t commandsReceived{ 0U };
+		uint64_t autocompleteRequests{ 0U };
+		// Average over all consoles, as measured by ENet, in milliseconds
+		uint32_t roundTripTime{ 0U };
+	};
+
+public:
+	bool Init( const LoadProfile& loadProfile );
+	void Shutdown();
+
+	// Services the host and sends whatever messages are due
+	// Returns false once the profile's duration is over
+	bool Update( uint32_t timeoutMilliseconds );
+
+	Statistics TakeStatistics();
+
+private:
+	// A connected console app
+	struct Client
+	{
+		bool isConnected;
+		ProtocolVersion::Enum protocolVersion;
+		bool isUnreliableAllowed;
+		// How many messages of each unreliable stream were sent so far
+		std::array<uint64_t, Network::MaxUnreliableStreams> sequences;
+	};
+
+	// A message waiting to be sent, its text is in messageText
+	struct GeneratedMessage
+	{
+		ConsoleMessageType::Enum type;
+		uint64_t timeMicroseconds;
+		size_t textOffset;
+		size_t textLength;
+	};
+
+	// Sent along with reliable log packets, to time their acknowledgement
+	struct PacketRecord
+	{
+		MockBridge* bridge;
+		uint64_t timeSent;
+		uint32_t numMessages;
+	};
+
+	void OnConnect( ENetPeer* peer, uint32_t connectData );
+	void OnReceive( ENetPeer* peer, ENetPacket* packet );
+	Client& GetClient( const ENetPeer* peer );
+
+	// 'C' packet: one or more commands
+	void HandleCommands( ENetPeer* peer, ENetPacket* packet );
+	// Runs a command and replies with its output
+	void ExecuteCommand( ENetPeer* peer, std::string_view command );
+	// 'L' packet: the console wants the whole catalogue
+	void HandleCatalogueRequest( ENetPeer* peer );
+	// 'A' packet: the console wants fresh values for a prefix
+	void HandleAutocompleteRequest( ENetPeer* peer, ENetPacket* packet );
+
+	void GenerateCatalogue();
+	// Appends an entry in the form of cvar_name#flags&value
+	void WriteCatalogueEntry( size_t index, std::vector<uint8_t>& bytes );
+
+	// Number of messages due by now, going by the rate and the bursts
+	size_t GetNumDueMessages();
+	// When the next message will be due, UINT64_MAX if none will
+	uint64_t GetNextDueTime() const;
+	void GenerateMessage();
+	void SendGeneratedMessages();
+	// Appends a batch of those generated messages that pass the filter, returns how many there were
+	template<typename FilterFn>
+	uint32_t WriteBatch( std::vector<uint8_t>& bytes, FilterFn filter ) const;
+	void SendLogPacket( ENetPeer* peer, NetworkChannel::Enum channel, const std::vector<uint8_t>& bytes,
+		uint32_t numMessages, bool reliable );
+	// Sends a single 'M' packet in the client's protocol version
+	void SendReply( ENetPeer* peer, NetworkChannel::Enum channel, std::string_view text );
+
+	static void ENET_CALLBACK OnLogPacketFreed( ENetPacket* packet );
+
+private:
+	LoadProfile profile{};
+	ENetHost* host{ nullptr };
+	std::vector<Client> clients{};
+	std::mt19937 random{};
+	// Built from the profile once, they're too costly to set up for every message
+	std::discrete_distribution<int> typeDistribution{};
+	std::uniform_int_distribution<size_t> lengthDistribution{};
+
+	uint64_t startTime{ 0U };
+	uint64_t rateStartTime{ 0U };
+	uint64_t numRateMessages{ 0U };
+	uint64_t lastBurstTime{ 0U };
+
+	std::vector<GeneratedMessage> generatedMessages{};
+	std::string messageText{};
+	std::vector<uint8_t> packetBytes{};
+	std::vector<std::string> catalogueNames{};
+
+	Statistics statistics{};
+};
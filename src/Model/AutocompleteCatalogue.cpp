@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "AutocompleteCatalogue.hpp"
+
+// ============================
+// AutocompleteRecords::Add
+// ============================
+bool AutocompleteRecords::Add( std::string_view entry )
+{
+	const size_t flagPosition = entry.find( '#' );
+	const size_t valuePosition = entry.find( '&', flagPosition );
+	if ( flagPosition == std::string_view::npos
+		|| valuePosition == std::string_view::npos )
+	{
+		return false;
+	}
+
+	uint32_t entryFlags = 0U;
+	for ( char flag : entry.substr( flagPosition + 1U, valuePosition - flagPosition - 1U ) )
+	{
+		if ( flag >= 'a' && flag <= 'z' )
+		{
+			entryFlags |= AutocompleteFlagBit( flag );
+		}
+	}
+
+	names.emplace_back( entry.substr( 0U, flagPosition ) );
+	flags.push_back( entryFlags );
+	values.emplace_back( entry.substr( valuePosition + 1U ) );
+	kinds.push_back( (entryFlags & FlagCommand) ? AutocompleteKind::Command : AutocompleteKind::Variable );
+	sources.push_back( 0U );
+	return true;
+}
+
+// ============================
+// AutocompleteRecords::Add
+// ============================
+void AutocompleteRecords::Add( AutocompleteRecords& other, size_t i )
+{
+	names.push_back( std::move( other.names[i] ) );
+	flags.push_back( other.flags[i] );
+	values.push_back( std::move( other.values[i] ) );
+	kinds.push_back( other.kinds[i] );
+	sources.push_back( other.sources[i] );
+}
+
+// ============================
+// AutocompleteRecords::Reserve
+// ============================
+void AutocompleteRecords::Reserve( size_t count )
+{
+	names.reserve( count );
+	flags.reserve( count );
+	values.reserve( count );
+	kinds.reserve( count );
+	sources.reserve( count );
+}
+
+// ============================
+// AutocompleteRecords::Clear
+// ============================
+void AutocompleteRecords::Clear()
+{
+	names.clear();
+	flags.clear();
+	values.clear();
+	kinds.clear();
+	sources.clear();
+}
+
+// ============================
+// AutocompleteCatalogue::Assign
+// ============================
+void AutocompleteCatalogue::Assign( uint8_t source, AutocompleteRecords&& newRecords )
+{
+	AutocompleteRecords kept{};
+	kept.Reserve( records.Size() );
+	for ( size_t i = 0U; i < records.Size(); i++ )
+	{
+		if ( records.sources[i] != source )
+		{
+			kept.Add( records, i );
+		}
+	}
+
+	records = std::move( kept );
+	Merge( source, std::move( newRecords ) );
+}
+
+// ============================
+// AutocompleteCatalogue::Merge
+// ============================
+void AutocompleteCatalogue::Merge( uint8_t source, AutocompleteRecords&& newRecords )
+{
+	records.Reserve( records.Size() + newRecords.Size() );
+	for ( size_t i = 0U; i < newRecords.Size(); i++ )
+	{
+		records.Add( newRecords, i );
+		records.sources.back() = source;
+	}
+
+	Sort();
+	revision++;
+}
+
+// ============================
+// AutocompleteCatalogue::Clear
+// ============================
+void AutocompleteCatalogue::Clear()
+{
+	records.Clear();
+	revision++;
+}
+
+// ============================
+// AutocompleteCatalogue::FindPrefix
+// ============================
+std::pair<size_t, size_t> AutocompleteCatalogue::FindPrefix( std::string_view prefix ) const
+{
+	const std::vector<std::string>& names = records.names;
+	const auto first = std::lower_bound( names.begin(), names.end(), prefix,
+		[]( const std::string& name, std::string_view value )
+		{
+			return std::string_view( name ) < value;
+		} );
+
+	// Everything from first onwards is >= prefix, so the matches are the ones
+	// that still compare equal once cut down to the prefix's length
+	const auto last = std::upper_bound( first, names.end(), prefix,
+		[]( std::string_view value, const std::string& name )
+		{
+			return value < std::string_view( name ).substr( 0, value.size() );
+		} );
+
+	return { size_t( first - names.begin() ), size_t( last - names.begin() ) };
+}
+
+// ============================
+// AutocompleteCatalogue::Sort
+// ============================
+void AutocompleteCatalogue::Sort()
+{
+	// Sort an index instead of shuffling five arrays around
+	// Stable, so that out of records with the same name and source, the newest one ends up last
+	std::vector<size_t> order( records.Size() );
+	for ( size_t i = 0U; i < order.size(); i++ )
+	{
+		order[i] = i;
+	}
+
+	std::stable_sort( order.begin(), order.end(),
+		[this]( size_t a, size_t b )
+		{
+			const int comparison = records.names[a].compare( records.names[b] );
+			return comparison < 0 || (comparison == 0 && records.sources[a] < records.sources[b]);
+		} );
+
+	AutocompleteRecords sorted{};
+	sorted.Reserve( order.size() );
+	for ( size_t i = 0U; i < order.size(); i++ )
+	{
+		// Keep only the newest record for each name from each source
+		if ( i + 1U < order.size() && records.sources[order[i + 1U]] == records.sources[order[i]]
+			&& records.names[order[i + 1U]] == records.names[order[i]] )
+		{
+			continue;
+		}
+
+		sorted.Add( records, order[i] );
+	}
+
+	records = std::move( sorted );
+}
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+struct AutocompleteKind final
+{
+	enum Enum : uint8_t
+	{
+		Variable,
+		Command
+	};
+};
+
+// Each flag letter from 'a' to 'z' gets its own bit
+constexpr uint32_t AutocompleteFlagBit( char letter )
+{
+	return 1U << (letter - 'a');
+}
+
+// ============================
+// AutocompleteRecords
+// 
+// Parsed autocomplete entries, stored as a struct of arrays
+// The bridge sends them as strings of this format:
+// cvar_name#flags&value
+// e.g. my_cvar#ri&100
+// ============================
+struct AutocompleteRecords
+{
+	static constexpr uint32_t FlagCommand = AutocompleteFlagBit( 'c' );
+	static constexpr uint32_t FlagReadOnly = AutocompleteFlagBit( 'r' );
+
+	// Parses and appends an entry, returns false if it's malformed
+	// Its source is set once the catalogue takes it in
+	bool Add( std::string_view entry );
+	// Appends record i of another set
+	void Add( AutocompleteRecords& other, size_t i );
+	void Reserve( size_t count );
+	void Clear();
+
+	size_t Size() const
+	{
+		return names.size();
+	}
+
+	std::vector<std::string> names{};
+	std::vector<uint32_t> flags{};
+	std::vector<std::string> values{};
+	std::vector<AutocompleteKind::Enum> kinds{};
+	// The engine the record came from, like ConsoleMessage::source
+	std::vector<uint8_t> sources{};
+};
+
+// ============================
+// AutocompleteCatalogue
+// 
+// Every cvar and console command the engines know about, kept sorted by name,
+// so all records starting with a prefix form one contiguous range
+// Each engine's records are kept apart, so several engines may have one name each
+// ============================
+class AutocompleteCatalogue final
+{
+public:
+	// Replaces all records from this source, the other engines' records stay
+	void Assign( uint8_t source, AutocompleteRecords&& newRecords );
+	// Adds new records, or replaces existing ones with the same name from this source
+	void Merge( uint8_t source, AutocompleteRecords&& newRecords );
+	void Clear();
+
+	// Returns the range [first, last) of records whose name starts with prefix
+	std::pair<size_t, size_t> FindPrefix( std::string_view prefix ) const;
+
+	const AutocompleteRecords& GetRecords() const
+	{
+		return records;
+	}
+
+	// Goes up every time the catalogue changes
+	uint32_t GetRevision() const
+	{
+		return revision;
+	}
+
+private:
+	void Sort();
+
+private:
+	AutocompleteRecords records{};
+	uint32_t revision{ 0U };
+};
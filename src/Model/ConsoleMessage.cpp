@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+
+// ============================
+// ConsoleMessage::CopyWithoutText
+// ============================
+ConsoleMessage ConsoleMessage::CopyWithoutText() const
+{
+	ConsoleMessage copy( text, timeSubmitted, type );
+	copy.source = source;
+	copy.repeatCount = repeatCount;
+	copy.timeLastRepeated = timeLastRepeated;
+	copy.colourSpans = colourSpans;
+	copy.extraColourSpans = extraColourSpans;
+	copy.numColourSpans = numColourSpans;
+	return copy;
+}
+
+// ============================
+// ConsoleMessage::ReleaseText
+// ============================
+void ConsoleMessage::ReleaseText()
+{
+	packet.reset();
+	ownedText.reset();
+}
+
+// ============================
+// ConsoleMessage::PacketDeleter
+// ============================
+void ConsoleMessage::PacketDeleter::operator()( ENetPacket* packet ) const
+{
+	enet_packet_destroy( packet );
+}
+
+// ============================
+// ConsoleMessage::ParseColourCodes
+// ============================
+void ConsoleMessage::ParseColourCodes( char* destination, ConsoleColourSpan* extraSpans, size_t maxExtraSpans )
+{
+	const size_t length = std::min( text.size(), MaxTextLength );
+
+	ConsoleColour::Enum currentColour = ConsoleColour::White;
+	numColourSpans = 0U;
+	extraColourSpans = nullptr;
+	const size_t maxSpans = MaxColourSpans + (nullptr != extraSpans ? maxExtraSpans : 0U);
+	ConsoleColourSpan* lastSpan = nullptr;
+
+	size_t writePosition = 0U;
+	for ( size_t i = 0U; i < length; i++ )
+	{
+		if ( text[i] == '$' )
+		{
+			i++;
+			if ( i >= length )
+			{
+				break;
+			}
+
+			currentColour = ConsoleColourCodeTable[static_cast<uint8_t>( text[i] )];
+			continue;
+		}
+
+		if ( nullptr == lastSpan
+			|| (lastSpan->colour != currentColour && numColourSpans < maxSpans) )
+		{
+			lastSpan = numColourSpans < MaxColourSpans ? &colourSpans[numColourSpans] : &extraSpans[numColourSpans - MaxColourSpans];
+			*lastSpan = { uint16_t( writePosition ), 0U, currentColour };
+			numColourSpans++;
+		}
+
+		lastSpan->length++;
+		destination[writePosition++] = text[i];
+	}
+
+	text = std::string_view( destination, writePosition );
+	if ( numColourSpans > MaxColourSpans )
+	{
+		extraColourSpans = extraSpans;
+	}
+}
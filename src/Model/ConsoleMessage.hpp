@@ -3,6 +3,10 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <memory>
+
 struct ConsoleMessageType final
 {
 	enum Enum
@@ -16,20 +20,122 @@ struct ConsoleMessageType final
 	};
 };
 
+// Colours that can be selected with "$x" codes inside message text
+struct ConsoleColour final
+{
+	enum Enum : uint8_t
+	{
+		White = 0,
+		Red,
+		Orange,
+		Yellow,
+		Green,
+		Blue,
+		Pink,
+		Gray,
+
+		Count
+	};
+};
+
+// Maps the character after a '$' to a colour, unknown codes are white
+constexpr std::array<ConsoleColour::Enum, 256> ConsoleColourCodeTable = []()
+{
+	std::array<ConsoleColour::Enum, 256> table{};
+	for ( auto& colour : table )
+	{
+		colour = ConsoleColour::White;
+	}
+
+	table['r'] = ConsoleColour::Red;
+	table['o'] = ConsoleColour::Orange;
+	table['y'] = ConsoleColour::Yellow;
+	table['g'] = ConsoleColour::Green;
+	table['b'] = ConsoleColour::Blue;
+	table['p'] = ConsoleColour::Pink;
+	table['w'] = ConsoleColour::White;
+	table['G'] = ConsoleColour::Gray;
+	return table;
+}();
+
+// A run of message text that is drawn in a single colour
+struct ConsoleColourSpan
+{
+	uint16_t offset;
+	uint16_t length;
+	ConsoleColour::Enum colour;
+};
+
 struct ConsoleMessage
 {
-	ConsoleMessage( std::string messageText = "", float messageTime = 0.0f, ConsoleMessageType::Enum messageType = ConsoleMessageType::Info )
+	// Spans kept in the message itself, the ones past these go wherever ParseColourCodes is told
+	static constexpr size_t MaxColourSpans = 8U;
+	// Longest text a stored message keeps, colour span offsets are 16-bit
+	// Version 2 of the protocol carries longer text just fine, it's cut off when stored
+	static constexpr size_t MaxTextLength = UINT16_MAX;
+
+	ConsoleMessage( std::string_view messageText = "", uint64_t messageTime = 0U, ConsoleMessageType::Enum messageType = ConsoleMessageType::Info )
 		: text( messageText ), timeSubmitted( messageTime ), type( messageType )
 	{
 	}
 
-	ConsoleMessage( const ConsoleMessage& message ) = default;
+	// Move-only, a message may own what its text points into, and only one of them gets to free it
+	ConsoleMessage( const ConsoleMessage& message ) = delete;
 	ConsoleMessage( ConsoleMessage&& message ) = default;
 
-	ConsoleMessage& operator=( const ConsoleMessage& message ) = default;
+	ConsoleMessage& operator=( const ConsoleMessage& message ) = delete;
 	ConsoleMessage& operator=( ConsoleMessage&& message ) = default;
 
-	std::string text;
-	float timeSubmitted;
+	// Copies everything but the packet and ownedText, so the copy's text is only valid while this message's is
+	ConsoleMessage CopyWithoutText() const;
+
+	// Copies the text into destination without the "$x" colour codes, records them
+	// as colour spans, then points the text at destination
+	// Destination must have room for text.size() bytes, text past MaxTextLength is dropped
+	// Spans past MaxColourSpans are written to extraSpans, which has room for maxExtraSpans,
+	// colour changes past those are ignored and the rest of the text keeps the last colour
+	// Meant to be called exactly once, when the message is stored
+	void ParseColourCodes( char* destination, ConsoleColourSpan* extraSpans = nullptr, size_t maxExtraSpans = 0U );
+
+	const ConsoleColourSpan& GetColourSpan( size_t index ) const
+	{
+		return index < MaxColourSpans ? colourSpans[index] : extraColourSpans[index - MaxColourSpans];
+	}
+
+	// The message doesn't own its text: it points into a string literal,
+	// a received network packet, or the text storage of MessageHistory
+	std::string_view text;
+	// In microseconds since the app started, a float would lose millisecond precision after a few hours
+	// Network moves engine times onto this clock as they come in
+	uint64_t timeSubmitted;
 	ConsoleMessageType::Enum type;
+
+	// Frees packet and ownedText, once whoever consumes the message has copied the text
+	// Destroying the message does the same
+	void ReleaseText();
+
+	struct PacketDeleter
+	{
+		void operator()( ENetPacket* packet ) const;
+	};
+
+	// Received packet the text points into. Only the last message decoded from a packet
+	// carries it, whoever consumes that message destroys the packet once the text is copied
+	std::unique_ptr<ENetPacket, PacketDeleter> packet{};
+	// Text the app made up itself, the message owns it until consumed like a packet
+	std::unique_ptr<char[]> ownedText{};
+
+	// Which engine sent the message, numbered from 1, 0 is the app itself
+	uint8_t source{ 0U };
+
+	// Identical messages in a row are folded into one by MessageHistory
+	// timeSubmitted stays the time of the first of them, this is the time of the last
+	uint32_t repeatCount{ 1U };
+	uint64_t timeLastRepeated{ 0U };
+
+	// Filled in by ParseColourCodes, they cover the whole text, read them with GetColourSpan
+	std::array<ConsoleColourSpan, MaxColourSpans> colourSpans{};
+	// Not owned, MessageHistory keeps them next to the text
+	const ConsoleColourSpan* extraColourSpans{ nullptr };
+	uint16_t numColourSpans{ 0U };
 };
@@ -0,0 +1,249 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "MessageHistory.hpp"
+
+// ============================
+// MessageHistory::ctor
+// ============================
+MessageHistory::MessageHistory( size_t historyCapacity )
+{
+	SetCapacity( historyCapacity );
+}
+
+// ============================
+// MessageHistory::SetCapacity
+// ============================
+void MessageHistory::SetCapacity( size_t historyCapacity )
+{
+	// A zero-sized ring buffer would make At() divide by zero
+	historyCapacity = std::max<size_t>( historyCapacity, 1U );
+	if ( historyCapacity == slots.size() )
+	{
+		return;
+	}
+
+	const size_t numKept = std::min( count, historyCapacity );
+	std::vector<ConsoleMessage> newSlots( historyCapacity );
+	for ( size_t i = End() - numKept; i < End(); i++ )
+	{
+		newSlots[i % historyCapacity] = std::move( At( i ) );
+	}
+
+	slots = std::move( newSlots );
+	count = numKept;
+
+	// Always have one chunk to spare, so the one being written into never has to be recycled
+	const size_t textBudget = historyCapacity * TextBytesPerMessage;
+	maxTextChunks = std::max<size_t>( 2U, (textBudget + TextChunkSize - 1U) / TextChunkSize + 1U );
+	ReleaseEvictedChunks();
+}
+
+// ============================
+// MessageHistory::Clear
+// ============================
+void MessageHistory::Clear()
+{
+	// Sequence indices keep going up, so anything that still refers
+	// to an old message will simply find it out of range
+	count = 0U;
+	ReleaseEvictedChunks();
+}
+
+// ============================
+// MessageHistory::Push
+// ============================
+bool MessageHistory::Push( const ConsoleMessage& message )
+{
+	// Most messages that aren't repeats are ruled out by the hash, the rest by comparing them in full
+	const uint64_t hash = HashMessage( message );
+	if ( count > 0U && hash == newestHash && IsRepeatOfNewest( message ) )
+	{
+		ConsoleMessage& newest = At( End() - 1U );
+		if ( newest.repeatCount < UINT32_MAX )
+		{
+			newest.repeatCount++;
+			newest.timeLastRepeated = message.timeSubmitted;
+			return false;
+		}
+	}
+
+	static_assert( ConsoleMessage::MaxTextLength <= TextChunkSize, "The longest text has to fit into one chunk" );
+	const size_t textLength = std::min( message.text.size(), ConsoleMessage::MaxTextLength );
+
+	// Colour spans that don't fit into the message go right after its text
+	// Every span past the first starts with a colour code, so the codes tell how many there can be
+	constexpr size_t SpanSize = sizeof( ConsoleColourSpan );
+	constexpr size_t SpanAlignment = alignof( ConsoleColourSpan );
+	const size_t maxSpans = size_t( std::count( message.text.begin(), message.text.begin() + textLength, '$' ) ) + 1U;
+	size_t maxExtraSpans = 0U;
+	size_t reservedLength = textLength;
+	if ( maxSpans > ConsoleMessage::MaxColourSpans )
+	{
+		// Text and spans have to share one chunk, a long message dense with colour codes may not fit them all
+		const size_t spanRoom = TextChunkSize - std::min( TextChunkSize, textLength + SpanAlignment );
+		maxExtraSpans = std::min( maxSpans - ConsoleMessage::MaxColourSpans, spanRoom / SpanSize );
+		reservedLength = maxExtraSpans > 0U ? textLength + SpanAlignment + maxExtraSpans * SpanSize : textLength;
+	}
+
+	char* text = AllocateText( reservedLength );
+	const uintptr_t spansAddress = reinterpret_cast<uintptr_t>( text + textLength ) + SpanAlignment - 1U;
+	auto* extraSpans = reinterpret_cast<ConsoleColourSpan*>( spansAddress & ~uintptr_t( SpanAlignment - 1U ) );
+
+	ConsoleMessage& slot = NextSlot();
+	slot = message.CopyWithoutText();
+	slot.text = message.text.substr( 0U, textLength );
+	slot.repeatCount = 1U;
+	slot.timeLastRepeated = message.timeSubmitted;
+	slot.ParseColourCodes( text, extraSpans, maxExtraSpans );
+	newestHash = hash;
+
+	// Colour codes were stripped, give back what wasn't needed
+	// With extra spans, only what's after the last of them can be given back
+	const size_t usedLength = nullptr != slot.extraColourSpans
+		? size_t( reinterpret_cast<const char*>( extraSpans + (slot.numColourSpans - ConsoleMessage::MaxColourSpans) ) - text )
+		: slot.text.size();
+	textChunks.back().used -= reservedLength - usedLength;
+	return true;
+}
+
+// ============================
+// MessageHistory::GetMemoryUsage
+// ============================
+size_t MessageHistory::GetMemoryUsage() const
+{
+	return slots.size() * sizeof( ConsoleMessage )
+		+ (textChunks.size() + freeTextChunks.size()) * TextChunkSize
+		+ comparisonText.capacity() + comparisonSpans.capacity() * sizeof( ConsoleColourSpan );
+}
+
+// ============================
+// MessageHistory::HashMessage
+// ============================
+uint64_t MessageHistory::HashMessage( const ConsoleMessage& message )
+{
+	constexpr uint64_t Prime = 0x100000001B3U;
+
+	uint64_t hash = 0xCBF29CE484222325U;
+	hash = (hash ^ uint64_t( message.type )) * Prime;
+	hash = (hash ^ uint64_t( message.source )) * Prime;
+	for ( const char c : message.text )
+	{
+		hash = (hash ^ uint8_t( c )) * Prime;
+	}
+
+	return hash;
+}
+
+// ============================
+// MessageHistory::IsRepeatOfNewest
+// ============================
+bool MessageHistory::IsRepeatOfNewest( const ConsoleMessage& message )
+{
+	const ConsoleMessage& newest = At( End() - 1U );
+	if ( newest.type != message.type || newest.source != message.source )
+	{
+		return false;
+	}
+
+	// The newest message was stored without its colour codes, so this one is stripped the same way
+	const size_t textLength = std::min( message.text.size(), ConsoleMessage::MaxTextLength );
+	const size_t maxSpans = size_t( std::count( message.text.begin(), message.text.begin() + textLength, '$' ) ) + 1U;
+	comparisonText.resize( textLength );
+	comparisonSpans.resize( maxSpans );
+
+	ConsoleMessage parsed = message.CopyWithoutText();
+	parsed.text = message.text.substr( 0U, textLength );
+	parsed.ParseColourCodes( comparisonText.data(), comparisonSpans.data(), comparisonSpans.size() );
+
+	if ( parsed.text != newest.text || parsed.numColourSpans != newest.numColourSpans )
+	{
+		return false;
+	}
+
+	for ( size_t i = 0U; i < parsed.numColourSpans; i++ )
+	{
+		const ConsoleColourSpan& span = parsed.GetColourSpan( i );
+		const ConsoleColourSpan& newestSpan = newest.GetColourSpan( i );
+		if ( span.offset != newestSpan.offset || span.length != newestSpan.length || span.colour != newestSpan.colour )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// ============================
+// MessageHistory::NextSlot
+// ============================
+ConsoleMessage& MessageHistory::NextSlot()
+{
+	ConsoleMessage& slot = slots[numPushed % slots.size()];
+
+	numPushed++;
+	if ( count < slots.size() )
+	{
+		count++;
+	}
+
+	return slot;
+}
+
+// ============================
+// MessageHistory::AllocateText
+// ============================
+char* MessageHistory::AllocateText( size_t length )
+{
+	ReleaseEvictedChunks();
+
+	if ( textChunks.empty() || textChunks.back().used + length > TextChunkSize )
+	{
+		if ( textChunks.size() >= maxTextChunks )
+		{
+			// Out of text budget, evict everything in the oldest chunk to make room
+			const size_t firstKept = std::min( textChunks.front().lastSequenceIndex + 1U, End() );
+			count = End() - std::max( firstKept, Begin() );
+			ReleaseEvictedChunks();
+		}
+
+		TextChunk chunk{ nullptr, 0U, End() };
+		if ( !freeTextChunks.empty() )
+		{
+			chunk.data = std::move( freeTextChunks.back() );
+			freeTextChunks.pop_back();
+		}
+		else
+		{
+			chunk.data = std::make_unique<char[]>( TextChunkSize );
+		}
+
+		textChunks.push_back( std::move( chunk ) );
+	}
+
+	TextChunk& chunk = textChunks.back();
+	char* text = chunk.data.get() + chunk.used;
+	chunk.used += length;
+	// This is the sequence index the message is about to get
+	chunk.lastSequenceIndex = End();
+	return text;
+}
+
+// ============================
+// MessageHistory::ReleaseEvictedChunks
+// ============================
+void MessageHistory::ReleaseEvictedChunks()
+{
+	while ( !textChunks.empty() )
+	{
+		TextChunk& chunk = textChunks.front();
+		if ( count > 0U && chunk.lastSequenceIndex >= Begin() )
+		{
+			break;
+		}
+
+		freeTextChunks.push_back( std::move( chunk.data ) );
+		textChunks.pop_front();
+	}
+}
@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <deque>
+#include <memory>
+
+// ============================
+// MessageHistory
+// 
+// Fixed-capacity ring buffer of console messages
+// Appending is O(1), once the buffer is full, the oldest message gets overwritten
+// 
+// Messages are addressed by their sequence index, i.e. the number of messages
+// that were pushed before them. A message keeps its sequence index for as long
+// as it's in the history, so the view can keep pointing at the same line while
+// older lines are being evicted.
+// 
+// Message text is copied into large chunks that are recycled once every
+// message in them has been evicted, so pushing doesn't allocate per message.
+// Colour spans that don't fit into a message are stored in the chunk after its text.
+// If the text doesn't fit into its budget, the oldest messages are evicted early.
+// 
+// A message identical to the newest one, same type, source and text including
+// colour codes, only bumps the newest one's repeat count. Messages are hashed
+// as they're pushed, so only a matching hash leads to comparing the text and
+// colour spans, which confirms the repeat.
+// ============================
+class MessageHistory final
+{
+public:
+	static constexpr size_t DefaultCapacity = 1024U;
+	// Bytes of text reserved per message of capacity
+	static constexpr size_t TextBytesPerMessage = 128U;
+	// Has to fit the longest text a message can have, ConsoleMessage::MaxTextLength
+	static constexpr size_t TextChunkSize = 64U * 1024U;
+
+public:
+	MessageHistory( size_t historyCapacity = DefaultCapacity );
+
+	// Resizes the ring buffer, keeping as many of the newest messages as will fit
+	void SetCapacity( size_t historyCapacity );
+	void Clear();
+
+	// Copies the message and its text into the history, parsing its colour codes on the way
+	// Returns false if it was a repeat of the newest message, in which case nothing new was stored
+	bool Push( const ConsoleMessage& message );
+
+	// Sequence index of the oldest message that is still stored
+	size_t Begin() const
+	{
+		return numPushed - count;
+	}
+
+	// Sequence index one past the newest message
+	size_t End() const
+	{
+		return numPushed;
+	}
+
+	size_t Size() const
+	{
+		return count;
+	}
+
+	size_t Capacity() const
+	{
+		return slots.size();
+	}
+
+	bool IsEmpty() const
+	{
+		return count == 0U;
+	}
+
+	// Expects Begin() <= sequenceIndex < End()
+	const ConsoleMessage& At( size_t sequenceIndex ) const
+	{
+		return slots[sequenceIndex % slots.size()];
+	}
+
+	ConsoleMessage& At( size_t sequenceIndex )
+	{
+		return slots[sequenceIndex % slots.size()];
+	}
+
+	// Bytes held by message slots and text chunks
+	size_t GetMemoryUsage() const;
+
+private:
+	struct TextChunk
+	{
+		std::unique_ptr<char[]> data;
+		size_t used;
+		// Sequence index of the newest message with text in this chunk
+		size_t lastSequenceIndex;
+	};
+
+	// FNV-1a over the type, source and text as received
+	static uint64_t HashMessage( const ConsoleMessage& message );
+	// Whether the message has the same type, source, text and colours as the newest one
+	// Only called when the hashes match, so different messages sharing a hash aren't folded
+	bool IsRepeatOfNewest( const ConsoleMessage& message );
+
+	ConsoleMessage& NextSlot();
+	// Returns room for the next message's text, evicting old messages if needed
+	char* AllocateText( size_t length );
+	// Recycles chunks whose messages have all been evicted
+	void ReleaseEvictedChunks();
+
+private:
+	std::vector<ConsoleMessage> slots{};
+	// Number of messages currently stored
+	size_t count{ 0U };
+	// Number of messages pushed over the lifetime of the history
+	size_t numPushed{ 0U };
+	// Hash of the newest message, repeats of it are folded in
+	uint64_t newestHash{ 0U };
+	// A message that might be a repeat gets its colour codes parsed into these, to compare it with the newest
+	std::vector<char> comparisonText{};
+	std::vector<ConsoleColourSpan> comparisonSpans{};
+
+	// Oldest first, the back one is being written into
+	std::deque<TextChunk> textChunks{};
+	std::vector<std::unique_ptr<char[]>> freeTextChunks{};
+	size_t maxTextChunks{ 2U };
+};
@@ -0,0 +1,406 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include <cstring>
+#include "MessageSearch.hpp"
+#include "MessageHistory.hpp"
+
+namespace
+{
+	// Maps ASCII letters to lowercase, everything else, UTF-8 included, to itself
+	constexpr std::array<uint8_t, 256> CaseFoldTable = []()
+	{
+		std::array<uint8_t, 256> table{};
+		for ( size_t i = 0U; i < table.size(); i++ )
+		{
+			table[i] = (i >= 'A' && i <= 'Z') ? uint8_t( i - 'A' + 'a' ) : uint8_t( i );
+		}
+
+		return table;
+	}();
+
+	uint8_t FoldCase( char c )
+	{
+		return CaseFoldTable[static_cast<uint8_t>( c )];
+	}
+
+	bool IsAsciiLetter( char c )
+	{
+		return FoldCase( c ) >= 'a' && FoldCase( c ) <= 'z';
+	}
+}
+
+// ============================
+// MessageSearch::ctor
+// ============================
+MessageSearch::MessageSearch( const MessageHistory& messageHistory )
+	: history( messageHistory ), blocksByTrigram( NumTrigramBuckets )
+{
+}
+
+// ============================
+// MessageSearch::Update
+// ============================
+void MessageSearch::Update()
+{
+	for ( size_t i = std::max( indexedEnd, history.Begin() ); i < history.End(); i++ )
+	{
+		IndexMessage( i );
+	}
+
+	indexedEnd = history.End();
+	Trim();
+}
+
+// ============================
+// MessageSearch::SetQuery
+// ============================
+void MessageSearch::SetQuery( std::string_view newQuery )
+{
+	Update();
+
+	// Every match of a query is also a match of any part of it
+	const bool isNarrowing = IsActive() && FindInText( newQuery, query ) != std::string_view::npos;
+	query = newQuery;
+	if ( query.empty() )
+	{
+		matches.clear();
+		return;
+	}
+
+	size_t numToCheck = history.Size();
+	if ( isNarrowing && query.size() >= TrigramLength )
+	{
+		std::vector<uint32_t> blocks{};
+		FindCandidateBlocks( query, blocks );
+		numToCheck = blocks.size() * BlockSize;
+	}
+
+	if ( isNarrowing && matches.size() < numToCheck )
+	{
+		const auto isGone = [this]( size_t sequenceIndex )
+		{
+			return FindInText( history.At( sequenceIndex ).text, query ) == std::string_view::npos;
+		};
+		matches.erase( std::remove_if( matches.begin(), matches.end(), isGone ), matches.end() );
+	}
+	else
+	{
+		std::vector<size_t> found{};
+		Find( query, found );
+		matches.assign( found.begin(), found.end() );
+	}
+
+	selectedMatch = matches.empty() ? history.End() : matches.back();
+}
+
+// ============================
+// MessageSearch::GetSelectedMatch
+// ============================
+size_t MessageSearch::GetSelectedMatch() const
+{
+	return matches.empty() ? history.End() : selectedMatch;
+}
+
+// ============================
+// MessageSearch::GetSelectedPosition
+// ============================
+size_t MessageSearch::GetSelectedPosition() const
+{
+	if ( matches.empty() )
+	{
+		return 0U;
+	}
+
+	return size_t( std::lower_bound( matches.begin(), matches.end(), selectedMatch ) - matches.begin() ) + 1U;
+}
+
+// ============================
+// MessageSearch::SelectOlder
+// ============================
+void MessageSearch::SelectOlder()
+{
+	if ( matches.empty() )
+	{
+		return;
+	}
+
+	const auto selected = std::lower_bound( matches.begin(), matches.end(), selectedMatch );
+	selectedMatch = selected == matches.begin() ? matches.back() : *(selected - 1);
+}
+
+// ============================
+// MessageSearch::SelectNewer
+// ============================
+void MessageSearch::SelectNewer()
+{
+	if ( matches.empty() )
+	{
+		return;
+	}
+
+	const auto next = std::upper_bound( matches.begin(), matches.end(), selectedMatch );
+	selectedMatch = next == matches.end() ? matches.front() : *next;
+}
+
+// ============================
+// MessageSearch::Find
+// ============================
+void MessageSearch::Find( std::string_view text, std::vector<size_t>& outMatches ) const
+{
+	if ( text.size() < TrigramLength )
+	{
+		Scan( text, outMatches );
+		return;
+	}
+
+	std::vector<uint32_t> candidates{};
+	FindCandidateBlocks( text, candidates );
+
+	// Having all the trigrams only means a block might have a match, the messages in it have the final say
+	for ( const uint32_t block : candidates )
+	{
+		const size_t first = std::max( size_t( block ) * BlockSize, history.Begin() );
+		const size_t last = std::min( (size_t( block ) + 1U) * BlockSize, history.End() );
+		for ( size_t i = first; i < last; i++ )
+		{
+			if ( FindInText( history.At( i ).text, text ) != std::string_view::npos )
+			{
+				outMatches.push_back( i );
+			}
+		}
+	}
+}
+
+// ============================
+// MessageSearch::Scan
+// ============================
+void MessageSearch::Scan( std::string_view text, std::vector<size_t>& outMatches ) const
+{
+	for ( size_t i = history.Begin(); i < history.End(); i++ )
+	{
+		if ( FindInText( history.At( i ).text, text ) != std::string_view::npos )
+		{
+			outMatches.push_back( i );
+		}
+	}
+}
+
+// ============================
+// MessageSearch::FindInText
+// ============================
+size_t MessageSearch::FindInText( std::string_view text, std::string_view what, size_t position )
+{
+	if ( what.empty() )
+	{
+		return position <= text.size() ? position : std::string_view::npos;
+	}
+
+	if ( position > text.size() || text.size() - position < what.size() )
+	{
+		return std::string_view::npos;
+	}
+
+	// Candidates are found with memchr, which goes through the text much faster than a byte-by-byte loop
+	// A letter has to be looked for in both cases, so any other byte makes a better anchor
+	size_t anchor = 0U;
+	while ( anchor < what.size() && IsAsciiLetter( what[anchor] ) )
+	{
+		anchor++;
+	}
+	anchor = anchor < what.size() ? anchor : 0U;
+
+	const uint8_t lower = FoldCase( what[anchor] );
+	const uint8_t upper = IsAsciiLetter( what[anchor] ) ? uint8_t( lower - 'a' + 'A' ) : lower;
+	// One past the last place the anchor can be
+	const char* const textEnd = text.data() + text.size() - (what.size() - anchor - 1U);
+	const auto findFrom = [textEnd]( const char* from, uint8_t byte )
+	{
+		const void* found = from < textEnd ? std::memchr( from, byte, size_t( textEnd - from ) ) : nullptr;
+		return nullptr != found ? static_cast<const char*>( found ) : textEnd;
+	};
+
+	const char* const first = text.data() + position + anchor;
+	const char* nextLower = findFrom( first, lower );
+	const char* nextUpper = lower != upper ? findFrom( first, upper ) : textEnd;
+	while ( true )
+	{
+		const char* const found = std::min( nextLower, nextUpper );
+		if ( found == textEnd )
+		{
+			return std::string_view::npos;
+		}
+
+		const char* const start = found - anchor;
+		size_t length = 0U;
+		while ( length < what.size() && FoldCase( start[length] ) == FoldCase( what[length] ) )
+		{
+			length++;
+		}
+
+		if ( length == what.size() )
+		{
+			return size_t( start - text.data() );
+		}
+
+		if ( found == nextLower )
+		{
+			nextLower = findFrom( found + 1, lower );
+		}
+		else
+		{
+			nextUpper = findFrom( found + 1, upper );
+		}
+	}
+}
+
+// ============================
+// MessageSearch::GetMemoryUsage
+// ============================
+size_t MessageSearch::GetMemoryUsage() const
+{
+	return blocksByTrigram.size() * sizeof( std::vector<uint32_t> ) + listBytes
+		+ numEntriesByBlock.size() * sizeof( uint32_t ) + matches.size() * sizeof( size_t );
+}
+
+// ============================
+// MessageSearch::GetTrigramBucket
+// ============================
+uint32_t MessageSearch::GetTrigramBucket( const char* trigram )
+{
+	static_assert( NumTrigramBuckets == 1U << 16U, "The hash below keeps the top 16 bits" );
+
+	// Fibonacci hashing, the top bits are the well-mixed ones
+	const uint32_t key = FoldCase( trigram[0] ) | (FoldCase( trigram[1] ) << 8U) | (FoldCase( trigram[2] ) << 16U);
+	return (key * 2654435769U) >> 16U;
+}
+
+// ============================
+// MessageSearch::FindCandidateBlocks
+// ============================
+void MessageSearch::FindCandidateBlocks( std::string_view text, std::vector<uint32_t>& outBlocks ) const
+{
+	// Intersecting the shortest lists first keeps the candidates few from the start
+	std::vector<const std::vector<uint32_t>*> lists{};
+	for ( size_t i = 0U; i + TrigramLength <= text.size(); i++ )
+	{
+		lists.push_back( &blocksByTrigram[GetTrigramBucket( &text[i] )] );
+	}
+
+	std::sort( lists.begin(), lists.end(), []( const auto* a, const auto* b )
+		{
+			// The same list can come up more than once, it has to end up next to itself to be removed
+			return a->size() != b->size() ? a->size() < b->size() : a < b;
+		} );
+	lists.erase( std::unique( lists.begin(), lists.end() ), lists.end() );
+
+	// Blocks the history has evicted may still be listed until the next sweep
+	const std::vector<uint32_t>& shortest = *lists.front();
+	outBlocks.assign( std::lower_bound( shortest.begin(), shortest.end(), uint32_t( history.Begin() / BlockSize ) ),
+		shortest.end() );
+
+	for ( size_t i = 1U; i < lists.size() && !outBlocks.empty(); i++ )
+	{
+		const std::vector<uint32_t>& list = *lists[i];
+		auto position = list.begin();
+		size_t numKept = 0U;
+		for ( const uint32_t block : outBlocks )
+		{
+			position = std::lower_bound( position, list.end(), block );
+			if ( position == list.end() )
+			{
+				break;
+			}
+
+			if ( *position == block )
+			{
+				outBlocks[numKept++] = block;
+			}
+		}
+
+		outBlocks.resize( numKept );
+	}
+}
+
+// ============================
+// MessageSearch::IndexMessage
+// ============================
+void MessageSearch::IndexMessage( size_t sequenceIndex )
+{
+	const std::string_view text = history.At( sequenceIndex ).text;
+	const size_t blockIndex = sequenceIndex / BlockSize;
+	const uint32_t block = uint32_t( blockIndex );
+
+	if ( numEntriesByBlock.empty() )
+	{
+		firstIndexedBlock = blockIndex;
+	}
+
+	while ( firstIndexedBlock + numEntriesByBlock.size() <= blockIndex )
+	{
+		numEntriesByBlock.push_back( 0U );
+	}
+
+	// Lists are appended to in order, so a trigram already seen in this block is always at the back
+	uint32_t& numEntries = numEntriesByBlock.back();
+	for ( size_t i = 0U; i + TrigramLength <= text.size(); i++ )
+	{
+		std::vector<uint32_t>& blocks = blocksByTrigram[GetTrigramBucket( &text[i] )];
+		if ( blocks.empty() || blocks.back() != block )
+		{
+			const size_t capacityBefore = blocks.capacity();
+			blocks.push_back( block );
+			listBytes += (blocks.capacity() - capacityBefore) * sizeof( uint32_t );
+			numEntries++;
+			numLiveEntries++;
+		}
+	}
+
+	if ( IsActive() && FindInText( text, query ) != std::string_view::npos )
+	{
+		if ( matches.empty() )
+		{
+			selectedMatch = sequenceIndex;
+		}
+
+		matches.push_back( sequenceIndex );
+	}
+}
+
+// ============================
+// MessageSearch::Trim
+// ============================
+void MessageSearch::Trim()
+{
+	const size_t firstBlock = history.Begin() / BlockSize;
+	while ( !numEntriesByBlock.empty() && firstIndexedBlock < firstBlock )
+	{
+		numLiveEntries -= numEntriesByBlock.front();
+		numStaleEntries += numEntriesByBlock.front();
+		numEntriesByBlock.pop_front();
+		firstIndexedBlock++;
+	}
+
+	// A sweep goes through the whole index, waiting until there's more stale than live
+	// entries makes it cost no more than what was indexed in the meantime
+	if ( numStaleEntries > numLiveEntries + NumTrigramBuckets )
+	{
+		for ( std::vector<uint32_t>& blocks : blocksByTrigram )
+		{
+			blocks.erase( blocks.begin(), std::lower_bound( blocks.begin(), blocks.end(), uint32_t( firstBlock ) ) );
+		}
+
+		numStaleEntries = 0U;
+	}
+
+	while ( !matches.empty() && matches.front() < history.Begin() )
+	{
+		matches.pop_front();
+	}
+
+	if ( !matches.empty() && selectedMatch < matches.front() )
+	{
+		selectedMatch = matches.front();
+	}
+}
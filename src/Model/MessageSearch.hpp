@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <deque>
+
+class MessageHistory;
+
+// ============================
+// MessageSearch
+//
+// Finds the messages in a history that contain some text, ignoring ASCII case
+//
+// Backed by a trigram index: the history is cut into blocks of BlockSize messages,
+// and for every trigram (three bytes, folded to lowercase) the index lists the blocks
+// it occurs in. A query only looks at the messages in blocks that have all of its trigrams.
+// Trigrams are hashed into NumTrigramBuckets lists, so the odd unrelated trigram shares a
+// list with the ones being looked for, which only means a few more blocks to check.
+// Listing blocks rather than messages keeps the index several times smaller than the text.
+// Queries shorter than a trigram have nothing to look up and scan every message instead.
+//
+// The index follows the history as messages are pushed and evicted, and so do the matches
+// of the current query, so counting them and stepping through them costs nothing.
+// When the query is typed out further, its previous matches are narrowed down instead,
+// if there are fewer of them than messages the index would have to check.
+// ============================
+class MessageSearch final
+{
+public:
+	static constexpr size_t BlockSize = 128U;
+	static constexpr size_t NumTrigramBuckets = 65536U;
+	static constexpr size_t TrigramLength = 3U;
+
+public:
+	MessageSearch( const MessageHistory& messageHistory );
+
+	// Indexes the messages pushed since the last call, and forgets the ones that were evicted
+	// Call whenever the history changes
+	void Update();
+
+	// Finds every message that contains the query, and keeps following it as messages
+	// come and go. The newest match is selected. An empty query ends the search.
+	void SetQuery( std::string_view newQuery );
+	const std::string& GetQuery() const
+	{
+		return query;
+	}
+
+	bool IsActive() const
+	{
+		return !query.empty();
+	}
+
+	size_t GetNumMatches() const
+	{
+		return matches.size();
+	}
+
+	// Sequence index of the selected match, or the history's End() if there are no matches
+	size_t GetSelectedMatch() const;
+	// Position of the selected match among all of them, counting from 1, or 0 if there are none
+	size_t GetSelectedPosition() const;
+	// Select the closest match before/after the selected one, wrapping around
+	void SelectOlder();
+	void SelectNewer();
+
+	// Appends the sequence index of every message that contains the query, oldest first
+	// Expects the index to be up to date
+	void Find( std::string_view text, std::vector<size_t>& outMatches ) const;
+	// Same as Find, but looks at every message instead of using the index
+	void Scan( std::string_view text, std::vector<size_t>& outMatches ) const;
+	// Position of the first occurrence of what in text at or after position, ignoring ASCII case
+	static size_t FindInText( std::string_view text, std::string_view what, size_t position = 0U );
+
+	// Bytes held by the index and the matches
+	size_t GetMemoryUsage() const;
+
+private:
+	static uint32_t GetTrigramBucket( const char* trigram );
+	// Blocks that contain every trigram of text, which has to be at least TrigramLength long
+	void FindCandidateBlocks( std::string_view text, std::vector<uint32_t>& outBlocks ) const;
+
+	void IndexMessage( size_t sequenceIndex );
+	// Drops the blocks and matches the history no longer has
+	void Trim();
+
+private:
+	const MessageHistory& history;
+
+	// Block numbers per trigram bucket, in ascending order, they wrap after ~500 billion messages
+	std::vector<std::vector<uint32_t>> blocksByTrigram;
+	// Sequence index of the next message to be indexed
+	size_t indexedEnd{ 0U };
+	// Entries in blocksByTrigram per block, from firstIndexedBlock on
+	std::deque<uint32_t> numEntriesByBlock{};
+	size_t firstIndexedBlock{ 0U };
+	// Entries of blocks that were evicted, they're swept out once they outnumber the live ones
+	size_t numLiveEntries{ 0U };
+	size_t numStaleEntries{ 0U };
+	// Bytes reserved by the lists in blocksByTrigram, kept up as they grow so it never has to be summed up
+	// Sweeping them out keeps their capacity, so there's nothing to take off then
+	size_t listBytes{ 0U };
+
+	std::string query{};
+	// Sequence indices of the messages that contain the query, oldest first
+	std::deque<size_t> matches{};
+	size_t selectedMatch{ 0U };
+};
@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+
+// ============================
+// SpscQueue
+// 
+// Bounded lock-free queue for handing items from exactly one producer
+// thread to exactly one consumer thread. Neither side ever blocks:
+// TryPush fails when the queue is full and TryPop fails when it's empty.
+// ============================
+template<typename T>
+class SpscQueue final
+{
+public:
+	// Capacity gets rounded up to a power of two
+	SpscQueue( size_t queueCapacity )
+	{
+		size_t powerOfTwo = 2U;
+		while ( powerOfTwo < queueCapacity )
+		{
+			powerOfTwo *= 2U;
+		}
+
+		slots.resize( powerOfTwo );
+		mask = powerOfTwo - 1U;
+	}
+
+	SpscQueue( const SpscQueue& queue ) = delete;
+	SpscQueue& operator=( const SpscQueue& queue ) = delete;
+
+	// Producer thread only
+	bool TryPush( T&& item )
+	{
+		const size_t tail = tailIndex.load( std::memory_order_relaxed );
+		if ( tail - cachedHeadIndex > mask )
+		{
+			// Looks full, re-read what the consumer has actually taken
+			cachedHeadIndex = headIndex.load( std::memory_order_acquire );
+			if ( tail - cachedHeadIndex > mask )
+			{
+				return false;
+			}
+		}
+
+		slots[tail & mask] = std::move( item );
+		tailIndex.store( tail + 1U, std::memory_order_release );
+		return true;
+	}
+
+	// Consumer thread only
+	bool TryPop( T& outItem )
+	{
+		const size_t head = headIndex.load( std::memory_order_relaxed );
+		if ( head == cachedTailIndex )
+		{
+			cachedTailIndex = tailIndex.load( std::memory_order_acquire );
+			if ( head == cachedTailIndex )
+			{
+				return false;
+			}
+		}
+
+		outItem = std::move( slots[head & mask] );
+		headIndex.store( head + 1U, std::memory_order_release );
+		return true;
+	}
+
+	// Producer thread only, pushes are guaranteed to succeed until this much is pushed
+	size_t FreeSpace()
+	{
+		cachedHeadIndex = headIndex.load( std::memory_order_acquire );
+		return slots.size() - (tailIndex.load( std::memory_order_relaxed ) - cachedHeadIndex);
+	}
+
+	// Approximate when called from a third thread, exact from either end
+	size_t Size() const
+	{
+		const size_t head = headIndex.load( std::memory_order_acquire );
+		const size_t tail = tailIndex.load( std::memory_order_acquire );
+		return tail - head;
+	}
+
+	size_t Capacity() const
+	{
+		return slots.size();
+	}
+
+private:
+	// Keep the producer's and consumer's indices on separate cache lines,
+	// so the two threads don't keep stealing the same line from each other
+	static constexpr size_t CacheLineSize = 64U;
+
+	std::vector<T> slots{};
+	size_t mask{ 0U };
+
+	// Owned by the consumer
+	alignas( CacheLineSize ) std::atomic<size_t> headIndex{ 0U };
+	// Consumer's last look at tailIndex
+	size_t cachedTailIndex{ 0U };
+
+	// Owned by the producer
+	alignas( CacheLineSize ) std::atomic<size_t> tailIndex{ 0U };
+	// Producer's last look at headIndex
+	size_t cachedHeadIndex{ 0U };
+};
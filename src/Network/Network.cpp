@@ -7,41 +7,96 @@
 #endif
 
 #include "Precompiled.hpp"
+#include "Model/AutocompleteCatalogue.hpp"
 #include "Network.hpp"
+#include "PacketAllocator.hpp"
+#include "PacketReader.hpp"
+#include "PacketWriter.hpp"
 
 // ============================
 // Network::Init
 // ============================
-bool Network::Init( std::function<OnReceiveMessageFn> receiveMessage,
+bool Network::Init( const std::vector<std::string>& endpoints,
+	std::function<OnReceiveMessagesFn> receiveMessages,
 	std::function<OnReceiveAutocompleteFn> receiveAutocomplete )
 {
-	onReceiveMessage = receiveMessage;
+	onReceiveMessages = receiveMessages;
 	onReceiveAutocomplete = receiveAutocomplete;
 
-	if ( enet_initialize() < 0 )
+	// Every packet, command and fragment ENet allocates comes out of the pool
+	if ( PacketAllocator::InitialiseEnet() < 0 )
 	{
-		onReceiveMessage( { "$y[DevConsoleApp] $rFailed to initialise ENet" } );
+		ReportStatus( "$y[DevConsoleApp] $rFailed to initialise ENet" );
 		return false;
 	}
 
-	enet_address_set_host_ip( &consoleBridgeAddress, "127.0.0.1" );
-	consoleBridgeAddress.port = 23005;
+	for ( const std::string& endpoint : endpoints )
+	{
+		if ( engines.size() >= MaxEngines )
+		{
+			ReportStatus( "$y[DevConsoleApp] $rToo many engines, ignoring the rest" );
+			break;
+		}
+
+		// Everything after the last colon is the port
+		const size_t colonPosition = endpoint.rfind( ':' );
+		const std::string host = endpoint.substr( 0U, colonPosition );
+
+		Engine engine{ endpoint, {}, nullptr, State::Inactive, uint8_t( engines.size() + 1U ), 0.0f, {}, ProtocolVersion::Legacy, false, 0, false };
+		engine.address.port = DefaultPort;
+		if ( colonPosition != std::string::npos )
+		{
+			engine.address.port = uint16_t( std::atoi( endpoint.c_str() + colonPosition + 1U ) );
+		}
 
-	consoleAppHost = enet_host_create( nullptr, 1, 2, 0, 0 );
-	consoleBridgePeer = nullptr;
+		if ( enet_address_set_host( &engine.address, host.c_str() ) < 0 || engine.address.port == 0U )
+		{
+			ReportStatus( "$y[DevConsoleApp] $rInvalid engine address '" + endpoint + "'" );
+			continue;
+		}
+
+		engines.push_back( std::move( engine ) );
+	}
+
+	if ( engines.empty() )
+	{
+		return false;
+	}
+
+	// Nothing is meant to connect to us, so the host only listens on loopback, unless an engine
+	// is on another machine and has to be reached from a routable address
+	// Connections from anyone else are dropped in Update either way
+	const bool areEnginesLocal = std::all_of( engines.begin(), engines.end(), []( const Engine& engine )
+		{
+			return (ENET_NET_TO_HOST_32( engine.address.host ) >> 24U) == 127U;
+		} );
+
+	// Bind to an ephemeral port right away, so we know where to send wake-ups
+	ENetAddress hostAddress{};
+	hostAddress.host = ENET_HOST_ANY;
+	hostAddress.port = 0;
+	if ( areEnginesLocal )
+	{
+		enet_address_set_host_ip( &hostAddress, "127.0.0.1" );
+	}
+
+	consoleAppHost = enet_host_create( &hostAddress, engines.size(), NetworkChannel::Count, 0, 0 );
 
 	if ( nullptr == consoleAppHost )
 	{
-		onReceiveMessage( { "$y[DevConsoleApp] $rFailed to create host" } );
+		ReportStatus( "$y[DevConsoleApp] $rFailed to create host" );
 		return false;
 	}
 
-	state = State::Connecting;
+	wakeSocket = enet_socket_create( ENET_SOCKET_TYPE_DATAGRAM );
+	enet_address_set_host_ip( &wakeAddress, "127.0.0.1" );
+	wakeAddress.port = consoleAppHost->address.port;
+
+	// The host exists from here on, so the first update can start connecting right away
+	running = true;
 	networkThread = std::thread( [this]()
 		{
-			// There needs to be a delay here, otherwise it'll crash
-			Wait( 1.0f );
-			while ( state != State::Inactive )
+			while ( running )
 			{
 				Update();
 			}
@@ -55,17 +110,41 @@ bool Network::Init( std::function<OnReceiveMessageFn> receiveMessage,
 // ============================
 void Network::Shutdown()
 {
-	state = State::Inactive;
+	running = false;
+	WakeNetworkThread();
 	networkThread.join();
-	UpdateWhileDisconnecting();
 
+	for ( Engine& engine : engines )
+	{
+		if ( nullptr != engine.peer )
+		{
+			enet_peer_disconnect( engine.peer, 0 );
+		}
+	}
+
+	// Give the disconnects a moment to go out, nobody is going to read what still comes in
+	ENetEvent netEvent{};
+	for ( int i = 0; i < 10; i++ )
+	{
+		if ( enet_host_service( consoleAppHost, &netEvent, 5 ) > 0 && netEvent.type == ENET_EVENT_TYPE_RECEIVE )
+		{
+			enet_packet_destroy( netEvent.packet );
+		}
+	}
+
+	FailPendingCommands();
+
+	// Frees the peers, and any packets still queued on them
+	enet_host_destroy( consoleAppHost );
 	consoleAppHost = nullptr;
-	consoleBridgePeer = nullptr;
+	engines.clear();
 
-	onReceiveMessage = nullptr;
+	onReceiveMessages = nullptr;
 	onReceiveAutocomplete = nullptr;
 
-	enet_host_destroy( consoleAppHost );
+	enet_socket_destroy( wakeSocket );
+	wakeSocket = ENET_SOCKET_NULL;
+
 	enet_deinitialize();
 }
 
@@ -74,162 +153,982 @@ void Network::Shutdown()
 // ============================
 void Network::Update()
 {
-	switch ( state )
+	const float now = Now();
+	for ( Engine& engine : engines )
 	{
-	case State::Connecting: return UpdateWhileConnecting();
-	case State::Connected: return UpdateWhileConnected();
-	case State::Disconnecting: return UpdateWhileDisconnecting();
+		if ( engine.state == State::Inactive && now >= engine.reconnectTime )
+		{
+			Connect( engine );
+		}
 	}
+
+	FlushCommands();
+	const uint32_t autocompleteTimeout = FlushAutocompleteRequest();
+
+	ENetEvent netEvent{};
+	while ( enet_host_service( consoleAppHost, &netEvent, 0 ) > 0 )
+	{
+		// The host takes datagrams from anywhere, so anyone can connect to a free peer slot
+		// Only the current connection of one of our engines is listened to, the rest is dropped
+		auto* engine = static_cast<Engine*>( netEvent.peer->data );
+		if ( nullptr == engine || netEvent.peer != engine->peer )
+		{
+			if ( netEvent.type == ENET_EVENT_TYPE_RECEIVE )
+			{
+				enet_packet_destroy( netEvent.packet );
+			}
+
+			if ( netEvent.type != ENET_EVENT_TYPE_DISCONNECT )
+			{
+				netEvent.peer->data = nullptr;
+				enet_peer_reset( netEvent.peer );
+			}
+			continue;
+		}
+
+		switch ( netEvent.type )
+		{
+		case ENET_EVENT_TYPE_CONNECT: OnConnected( *engine ); break;
+		case ENET_EVENT_TYPE_DISCONNECT: OnDisconnected( *engine ); break;
+		case ENET_EVENT_TYPE_RECEIVE: OnReceive( *engine, netEvent.packet ); break;
+		default: break;
+		}
+	}
+
+	SampleConnections();
+
+	if ( firstMessageTime != 0U && !hasReportedFirstMessage )
+	{
+		char text[96];
+		snprintf( text, sizeof( text ), "$y[DevConsoleApp] $gFirst message arrived %.1f ms after startup", firstMessageTime / 1000.0f );
+		ReportStatus( text );
+		hasReportedFirstMessage = true;
+	}
+
+	// Sleep until an engine sends something or a command is submitted
+	// Otherwise only wake up when something is due: an autocomplete request, a reconnect, or ENet's own housekeeping
+	WaitForNetworkActivity( std::min( autocompleteTimeout, GetHousekeepingTimeout() ) );
+}
+
+// ============================
+// Network::GetHousekeepingTimeout
+// Besides reconnects, mirrors the checks enet_host_service makes on its own: an unacknowledged
+// command is resent once its round-trip timeout passes, which is also where connects and
+// connections time out, and a quiet connection is pinged every ping interval
+// ============================
+uint32_t Network::GetHousekeepingTimeout() const
+{
+	const enet_uint32 now = enet_time_get();
+	uint32_t timeout = MaxWaitMilliseconds;
+	for ( const Engine& engine : engines )
+	{
+		// Checked after servicing, an engine may have only just been lost
+		if ( engine.state == State::Inactive )
+		{
+			const float timeLeft = std::max( engine.reconnectTime - Now(), 0.0f );
+			timeout = std::min( timeout, uint32_t( timeLeft * 1000.0f ) + 1U );
+			continue;
+		}
+
+		// ENet's clock wraps around, so deadlines are compared by their signed distance from now
+		ENetPeer* peer = engine.peer;
+		int32_t timeLeft = int32_t( MaxWaitMilliseconds );
+		if ( enet_list_empty( &peer->sentReliableCommands ) )
+		{
+			if ( engine.state == State::Connected )
+			{
+				timeLeft = int32_t( peer->lastReceiveTime + peer->pingInterval - now );
+			}
+		}
+		else
+		{
+			// ENet keeps this at the oldest unacknowledged command's resend time
+			timeLeft = int32_t( peer->nextTimeout - now );
+		}
+
+		timeout = std::min( timeout, uint32_t( std::max( timeLeft, 0 ) ) + 1U );
+	}
+
+	return timeout;
 }
 
 // ============================
-// Network::RequestAutocompleteUpdate
+// Network::GetStatistics
 // ============================
-void Network::RequestAutocompleteUpdate( std::string_view command )
+Network::Statistics Network::GetStatistics() const
 {
-	requestAutocomplete = true;
-	autocompleteCommand = command;
+	Statistics statistics{};
+	statistics.messagesReceived = numMessagesReceived.load( std::memory_order_relaxed );
+	statistics.bytesReceived = numBytesReceived.load( std::memory_order_relaxed );
+	statistics.messagesLost = numMessagesLost.load( std::memory_order_relaxed );
+	statistics.roundTripTime = averageRoundTripTime.load( std::memory_order_relaxed );
+	statistics.packetLoss = float( averagePacketLoss.load( std::memory_order_relaxed ) ) / float( ENET_PEER_PACKET_LOSS_SCALE );
+	statistics.numConnected = numConnectedEngines.load( std::memory_order_relaxed );
+	return statistics;
 }
 
 // ============================
 // Network::SubmitCommand
 // ============================
-void Network::SubmitCommand( std::string_view command )
+std::future<bool> Network::SubmitCommand( std::string_view command, size_t target )
 {
-	this->command = command;
-	sendCommand = true;
+	PendingCommand pendingCommand{ std::string( command ), target, std::make_shared<CommandDelivery>() };
+	pendingCommand.delivery->numPending = 0U;
+	pendingCommand.delivery->delivered = true;
+	std::future<bool> delivered = pendingCommand.delivery->promise.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock( commandMutex );
+		pendingCommands.push_back( std::move( pendingCommand ) );
+	}
+
+	WakeNetworkThread();
+	return delivered;
 }
 
 // ============================
-// Network::UpdateWhileConnecting
+// Network::RequestAutocomplete
 // ============================
-void Network::UpdateWhileConnecting()
+void Network::RequestAutocomplete( std::string_view prefix )
 {
-	ENetEvent netEvent{};
-	onReceiveMessage( { "$y[DevConsoleApp] Trying connection... (127.0.0.1:23005)", Now() } );
-	
-	if ( nullptr == consoleBridgePeer )
 	{
-		consoleBridgePeer = enet_host_connect( consoleAppHost, &consoleBridgeAddress, 1, 0 );
+		std::lock_guard<std::mutex> lock( autocompleteMutex );
+		pendingAutocompletePrefix = prefix;
+		hasPendingAutocomplete = true;
+		autocompleteDueTime = Now() + AutocompleteDebounceSeconds;
+		// From here on, replies to anything sent earlier are stale
+		latestAutocompleteId++;
+	}
+
+	// Let the network thread shorten its wait to the new due time
+	WakeNetworkThread();
+}
+
+// ============================
+// Network::Connect
+// ============================
+void Network::Connect( Engine& engine )
+{
+	if ( !engine.isRetrying )
+	{
+		ReportStatus( "$y[DevConsoleApp] Trying connection... (" + engine.name + ")", engine.source );
+	}
+
+	uint32_t connectData = ProtocolVersion::Latest << ConnectFlag::VersionShift;
+	if ( allowUnreliableLogs )
+	{
+		connectData |= ConnectFlag::UnreliableLogs;
 	}
 
-	if ( enet_host_service( consoleAppHost, &netEvent, 1500 ) > 0 )
+	engine.peer = enet_host_connect( consoleAppHost, &engine.address, NetworkChannel::Count, connectData );
+	if ( nullptr == engine.peer )
 	{
-		onReceiveMessage( { "$y[DevConsoleApp] $gSuccessfully connected to an instance of Elegy Engine", Now() } );
-		state = State::Connected;
+		engine.reconnectTime = Now() + ReconnectDelaySeconds;
 		return;
 	}
-	
-	onReceiveMessage( { "$y[DevConsoleApp] Connection failed", Now() } );
-	Wait( 0.5f );
 
-	enet_peer_reset( consoleBridgePeer );
-	consoleBridgePeer = nullptr;
+	// ENet only gives up on a connection attempt after several seconds, an engine
+	// that's running on this machine answers right away
+	engine.peer->data = &engine;
+	enet_peer_timeout( engine.peer, 0, ConnectTimeoutMilliseconds, ConnectTimeoutMilliseconds );
+	engine.state = State::Connecting;
+	// The engine starts its streams over for every connection, and may have been updated in between
+	engine.nextSequences = {};
+	engine.protocolVersion = ProtocolVersion::Legacy;
+	// Or it may have been restarted, with its clock
+	engine.hasClockOffset = false;
+}
+
+// ============================
+// Network::OnConnected
+// ============================
+void Network::OnConnected( Engine& engine )
+{
+	ReportStatus( "$y[DevConsoleApp] $gSuccessfully connected to an instance of Elegy Engine", engine.source );
+
+	// Back to the defaults, so a busy engine doesn't get dropped as quickly
+	enet_peer_timeout( engine.peer, 0, 0, 0 );
+	engine.state = State::Connected;
+	engine.isRetrying = false;
+	RequestAutocompleteCatalogue( engine );
+}
+
+// ============================
+// Network::OnDisconnected
+// ============================
+void Network::OnDisconnected( Engine& engine )
+{
+	const bool wasConnected = engine.state != State::Connecting;
+	if ( !wasConnected )
+	{
+		ReportStatus( "$y[DevConsoleApp] Connection failed, retrying", engine.source );
+		engine.isRetrying = true;
+	}
+	else
+	{
+		ReportStatus( "$y[DevConsoleApp] Disconnected!", engine.source );
+	}
+
+	// ENet has already reset the peer by now, the slot may go to a stranger next
+	engine.peer->data = nullptr;
+	engine.peer = nullptr;
+	engine.state = State::Inactive;
+	engine.reconnectTime = Now() + ReconnectDelaySeconds;
+
+	// Its entries go, the other engines' stay, and it sends all of its own again on reconnecting
+	if ( wasConnected )
+	{
+		onReceiveAutocomplete( {}, engine.source, true );
+	}
 }
 
 // ============================
-// Network::UpdateWhileConnected
+// Network::OnReceive
 // ============================
-void Network::UpdateWhileConnected()
+void Network::OnReceive( Engine& engine, ENetPacket* packet )
 {
-	if ( sendCommand )
+	AddToCounter( numBytesReceived, packet->dataLength );
+
+	// Dispatched on the packet type rather than the channel it came in on,
+	// so a bridge that sends everything on one channel still works
+	const auto* data = packet->data;
+	if ( packet->dataLength == 0U || engine.state != State::Connected )
+	{
+		enet_packet_destroy( packet );
+	}
+	else if ( data[0] == 'X' )
+	{
+		// The engine is shutting down, the disconnect event follows once it's acknowledged
+		enet_packet_destroy( packet );
+		enet_peer_disconnect( engine.peer, 0 );
+		engine.state = State::Disconnecting;
+	}
+	else if ( data[0] == 'H' )
+	{
+		DecodeHandshakePacket( packet, engine );
+	}
+	// Message packets are handed over to the view, which destroys them
+	else if ( data[0] == 'M' )
+	{
+		DecodeMessagePacket( packet, engine );
+	}
+	else if ( data[0] == 'B' )
+	{
+		DecodeBatchPacket( packet, engine );
+	}
+	else if ( data[0] == 'U' )
+	{
+		DecodeUnreliablePacket( packet, engine );
+	}
+	else if ( data[0] == 'L' || data[0] == 'l' )
+	{
+		DecodeCataloguePacket( packet, engine, data[0] == 'L' );
+	}
+	else if ( data[0] == 'a' )
+	{
+		DecodeAutocompletePacket( packet, engine );
+	}
+	else
 	{
-		std::vector<byte> packetBytes = EncodeMessage( command );
+		enet_packet_destroy( packet );
+	}
+}
 
-		ENetPacket* packet = enet_packet_create( packetBytes.data(), packetBytes.size(), ENET_PACKET_FLAG_RELIABLE);
-		enet_host_broadcast( consoleAppHost, 0, packet );
+// ============================
+// Network::IsAnyEngineConnected
+// ============================
+bool Network::IsAnyEngineConnected() const
+{
+	return std::any_of( engines.begin(), engines.end(), []( const Engine& engine )
+		{
+			return engine.state == State::Connected;
+		} );
+}
 
-		sendCommand = false;
+// ============================
+// Network::SampleConnections
+// ============================
+void Network::SampleConnections()
+{
+	uint32_t numConnected = 0U;
+	uint32_t totalRoundTripTime = 0U;
+	uint32_t totalPacketLoss = 0U;
+	for ( const Engine& engine : engines )
+	{
+		if ( engine.state == State::Connected )
+		{
+			numConnected++;
+			totalRoundTripTime += engine.peer->roundTripTime;
+			totalPacketLoss += engine.peer->packetLoss;
+		}
 	}
 
-	int numMessagesAdded = 0;
-	ENetEvent netEvent{};
-	while ( enet_host_service( consoleAppHost, &netEvent, 0 ) > 0 )
+	numConnectedEngines.store( numConnected, std::memory_order_relaxed );
+	averageRoundTripTime.store( numConnected > 0U ? totalRoundTripTime / numConnected : 0U, std::memory_order_relaxed );
+	averagePacketLoss.store( numConnected > 0U ? totalPacketLoss / numConnected : 0U, std::memory_order_relaxed );
+}
+
+// ============================
+// Network::CountReceivedMessages
+// ============================
+void Network::CountReceivedMessages( size_t numMessages )
+{
+	if ( firstMessageTime == 0U )
 	{
-		if ( netEvent.type == ENET_EVENT_TYPE_RECEIVE )
+		firstMessageTime = NowMicroseconds();
+	}
+
+	AddToCounter( numMessagesReceived, numMessages );
+}
+
+// ============================
+// Network::FlushCommands
+// ============================
+void Network::FlushCommands()
+{
+	{
+		std::lock_guard<std::mutex> lock( commandMutex );
+		std::swap( pendingCommands, commandsToSend );
+	}
+
+	if ( commandsToSend.empty() )
+	{
+		return;
+	}
+
+	// Commands whose engines aren't there yet wait in the queue
+	for ( size_t i = 0U; i < commandsToSend.size(); )
+	{
+		PendingCommand& pendingCommand = commandsToSend[i];
+		const size_t target = pendingCommand.target;
+		if ( target > engines.size() )
+		{
+			ReportStatus( "$y[DevConsoleApp] $rThere is no engine @" + std::to_string( target ) );
+			pendingCommand.delivery->promise.set_value( false );
+		}
+		else if ( target == BroadcastTarget ? !IsAnyEngineConnected() : engines[target - 1U].state != State::Connected )
+		{
+			commandsToKeep.push_back( std::move( pendingCommand ) );
+		}
+		else
+		{
+			// Held until every engine's packet is built, so an early failure can't resolve it
+			pendingCommand.delivery->numPending = 1U;
+			i++;
+			continue;
+		}
+
+		commandsToSend.erase( commandsToSend.begin() + i );
+	}
+
+	// Everything for one engine goes out as one packet of 'C' records, but engines older
+	// than ProtocolVersion::Varint only read the first record, so they get a packet per command
+	for ( Engine& engine : engines )
+	{
+		if ( engine.state != State::Connected )
 		{
-			const auto* data = netEvent.packet->data;
-			if ( data[0] == 'X' )
+			continue;
+		}
+
+		const bool canBatch = engine.protocolVersion >= ProtocolVersion::Varint;
+		CommandBatch* batch = nullptr;
+		for ( PendingCommand& pendingCommand : commandsToSend )
+		{
+			if ( pendingCommand.target != BroadcastTarget && pendingCommand.target != engine.source )
+			{
+				continue;
+			}
+
+			if ( nullptr == batch )
 			{
-				onReceiveMessage( { "$y[DevConsoleApp] Disconnected!" } );
-				onReceiveAutocomplete( {} );
-				state = State::Disconnecting;
-				return;
+				batch = new CommandBatch{};
+				commandPacketBytes.clear();
 			}
-			else if ( data[0] == 'M' )
+
+			if ( !EncodeMessage( pendingCommand.command, engine.protocolVersion, commandPacketBytes ) )
 			{
-				const int TypeOffset = 1;
-				const int TimeOffset = TypeOffset + sizeof( byte );
-				const int LengthOffset = TimeOffset + sizeof( float );
-				const int TextOffset = LengthOffset + sizeof( uint16_t );
-
-				ConsoleMessage message{};
-				message.type = static_cast<ConsoleMessageType::Enum>( data[TypeOffset] );
-				message.timeSubmitted = *reinterpret_cast<const float*>( &data[TimeOffset] );
-
-				size_t messageLength = *reinterpret_cast<const uint16_t*>( &data[LengthOffset] );
-				message.text = std::string( reinterpret_cast<const char*>( &data[TextOffset] ), messageLength );
-
-				onReceiveMessage( message );
-				
-				// It's aesthetically pleasing to see them coming in batches
-				if ( ++numMessagesAdded >= 15 )
-				{
-					Wait( 0.015f );
-					numMessagesAdded = 0;
-				}
+				ReportStatus( "$y[DevConsoleApp] $rCommand too long for this engine's protocol version", engine.source );
+				pendingCommand.delivery->delivered = false;
+				continue;
+			}
+
+			pendingCommand.delivery->numPending++;
+			batch->deliveries.push_back( pendingCommand.delivery );
+
+			if ( !canBatch )
+			{
+				SendCommandPacket( engine, batch );
+				batch = nullptr;
 			}
 		}
-		else if ( netEvent.type == ENET_EVENT_TYPE_DISCONNECT )
+
+		if ( nullptr != batch )
 		{
-			onReceiveMessage( { "$y[DevConsoleApp] Disconnected!" } );
-			onReceiveAutocomplete( {} );
-			state = State::Disconnecting;
-			return;
+			SendCommandPacket( engine, batch );
 		}
 	}
 
-	// Do not burn the CPU
-	Wait( 0.1f );
+	for ( PendingCommand& pendingCommand : commandsToSend )
+	{
+		ResolveDelivery( *pendingCommand.delivery, true );
+	}
+	commandsToSend.clear();
+
+	if ( !commandsToKeep.empty() )
+	{
+		std::lock_guard<std::mutex> lock( commandMutex );
+		pendingCommands.insert( pendingCommands.begin(),
+			std::make_move_iterator( commandsToKeep.begin() ), std::make_move_iterator( commandsToKeep.end() ) );
+		commandsToKeep.clear();
+	}
 }
 
 // ============================
-// Network::UpdateWhileDisconnecting
+// Network::SendCommandPacket
 // ============================
-void Network::UpdateWhileDisconnecting()
+void Network::SendCommandPacket( Engine& engine, CommandBatch* batch )
 {
-	if ( nullptr != consoleBridgePeer )
+	if ( batch->deliveries.empty() )
 	{
-		enet_peer_disconnect( consoleBridgePeer, 0 );
+		delete batch;
+		return;
 	}
 
-	ENetEvent netEvent{};
-	for ( int i = 0; i < 10; i++ )
+	ENetPacket* packet = enet_packet_create( commandPacketBytes.data(), commandPacketBytes.size(), ENET_PACKET_FLAG_RELIABLE );
+	packet->userData = batch;
+	packet->freeCallback = &Network::OnCommandPacketFreed;
+
+	if ( enet_peer_send( engine.peer, GetChannel( engine.peer, NetworkChannel::Commands ), packet ) < 0 )
 	{
-		enet_host_service( consoleAppHost, &netEvent, 5 );
+		// ENet didn't take ownership, so the callback is up to us, and reports the commands as undelivered
+		enet_packet_destroy( packet );
 	}
+}
 
-	state = State::Connecting;
+// ============================
+// Network::FailPendingCommands
+// ============================
+void Network::FailPendingCommands()
+{
+	std::lock_guard<std::mutex> lock( commandMutex );
+	for ( PendingCommand& pendingCommand : pendingCommands )
+	{
+		pendingCommand.delivery->promise.set_value( false );
+	}
+	pendingCommands.clear();
+}
+
+// ============================
+// Network::ResolveDelivery
+// ============================
+void Network::ResolveDelivery( CommandDelivery& delivery, bool delivered )
+{
+	delivery.delivered = delivery.delivered && delivered;
+	delivery.numPending--;
+	if ( delivery.numPending == 0U )
+	{
+		delivery.promise.set_value( delivery.delivered );
+	}
+}
+
+// ============================
+// Network::OnCommandPacketFreed
+// ============================
+void ENET_CALLBACK Network::OnCommandPacketFreed( ENetPacket* packet )
+{
+	auto* batch = static_cast<CommandBatch*>( packet->userData );
+
+	// ENet only flags a reliable packet as sent when the peer has acknowledged all of it
+	// Packets thrown out with the peer's queues on a disconnect or reset are freed without the flag,
+	// and that can happen while the peer still counts as connected, so its state says nothing here
+	const bool delivered = (packet->flags & ENET_PACKET_FLAG_SENT) != 0U;
+
+	for ( std::shared_ptr<CommandDelivery>& delivery : batch->deliveries )
+	{
+		ResolveDelivery( *delivery, delivered );
+	}
+
+	delete batch;
+}
+
+// ============================
+// Network::GetChannel
+// ============================
+enet_uint8 Network::GetChannel( const ENetPeer* peer, NetworkChannel::Enum channel )
+{
+	return enet_uint8( std::min<size_t>( channel, peer->channelCount - 1U ) );
+}
+
+// ============================
+// Network::WaitForNetworkActivity
+// ============================
+void Network::WaitForNetworkActivity( uint32_t timeoutMilliseconds )
+{
+	enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
+	enet_socket_wait( consoleAppHost->socket, &condition, timeoutMilliseconds );
+}
+
+// ============================
+// Network::WakeNetworkThread
+// ============================
+void Network::WakeNetworkThread()
+{
+	if ( ENET_SOCKET_NULL == wakeSocket )
+	{
+		return;
+	}
+
+	static const char WakeByte = 'W';
+	ENetBuffer buffer{};
+	buffer.data = const_cast<char*>( &WakeByte );
+	buffer.dataLength = 1U;
+
+	enet_socket_send( wakeSocket, &wakeAddress, &buffer, 1U );
+}
+
+// ============================
+// Network::RequestAutocompleteCatalogue
+// ============================
+void Network::RequestAutocompleteCatalogue( Engine& engine )
+{
+	const byte request = 'L';
+	ENetPacket* packet = enet_packet_create( &request, sizeof( request ), ENET_PACKET_FLAG_RELIABLE );
+	if ( enet_peer_send( engine.peer, GetChannel( engine.peer, NetworkChannel::Autocomplete ), packet ) < 0 )
+	{
+		enet_packet_destroy( packet );
+	}
+}
+
+// ============================
+// Network::FlushAutocompleteRequest
+// 
+// Layout:
+// 'A'
+// varint: request id
+// varint: prefix length
+// bytes: prefix
+// ============================
+uint32_t Network::FlushAutocompleteRequest()
+{
+	uint32_t requestId;
+	{
+		std::lock_guard<std::mutex> lock( autocompleteMutex );
+		if ( !hasPendingAutocomplete )
+		{
+			return MaxWaitMilliseconds;
+		}
+
+		// Still typing
+		const float timeLeft = autocompleteDueTime - Now();
+		if ( timeLeft > 0.0f )
+		{
+			return uint32_t( timeLeft * 1000.0f ) + 1U;
+		}
+
+		requestId = latestAutocompleteId;
+		hasPendingAutocomplete = false;
+		autocompletePacketBytes.clear();
+		PacketWriter writer( autocompletePacketBytes );
+		writer.WriteByte( 'A' );
+		writer.WriteVarint( requestId );
+		writer.WriteVarint( pendingAutocompletePrefix.size() );
+		writer.WriteString( pendingAutocompletePrefix );
+	}
+
+	// Every engine gets the same packet, whichever replies are current get merged
+	// Sending it cancels the one that's in flight
+	inFlightAutocompleteId = requestId;
+	ENetPacket* packet = enet_packet_create( autocompletePacketBytes.data(), autocompletePacketBytes.size(), ENET_PACKET_FLAG_RELIABLE );
+	for ( Engine& engine : engines )
+	{
+		if ( engine.state == State::Connected )
+		{
+			enet_peer_send( engine.peer, GetChannel( engine.peer, NetworkChannel::Autocomplete ), packet );
+		}
+	}
+
+	// Nobody took it
+	if ( packet->referenceCount == 0U )
+	{
+		enet_packet_destroy( packet );
+	}
+
+	return MaxWaitMilliseconds;
+}
+
+// ============================
+// Network::ReportStatus
+// ============================
+void Network::ReportStatus( std::string_view text, uint8_t source )
+{
+	ConsoleMessage message = CreateStatusMessage( text, source );
+	onReceiveMessages( &message, 1U );
+}
+
+// ============================
+// Network::CreateStatusMessage
+// ============================
+ConsoleMessage Network::CreateStatusMessage( std::string_view text, uint8_t source )
+{
+	ConsoleMessage message( "", NowMicroseconds() );
+	message.source = source;
+
+	// The view only copies the text once it gets around to it, so the message owns a copy until then
+	message.ownedText = std::make_unique<char[]>( text.size() );
+	std::copy( text.begin(), text.end(), message.ownedText.get() );
+	message.text = std::string_view( message.ownedText.get(), text.size() );
+
+	return message;
+}
+
+// ============================
+// Network::ToAppTime
+// ============================
+void Network::ToAppTime( Engine& engine, ConsoleMessage* messages, size_t numMessages )
+{
+	if ( numMessages == 0U )
+	{
+		return;
+	}
+
+	// The newest message of the first packet of a connection sets the offset, it's off by the time the
+	// packet took to get here, far less than a line's worth of difference once they're drawn
+	// Engine clocks run at the same rate as ours, only their start differs
+	if ( !engine.hasClockOffset )
+	{
+		engine.clockOffset = int64_t( NowMicroseconds() ) - int64_t( messages[numMessages - 1U].timeSubmitted );
+		engine.hasClockOffset = true;
+	}
+
+	for ( size_t i = 0U; i < numMessages; i++ )
+	{
+		// Logged before the app started
+		messages[i].timeSubmitted = uint64_t( std::max<int64_t>( int64_t( messages[i].timeSubmitted ) + engine.clockOffset, 0 ) );
+	}
+}
+
+// ============================
+// Network::DecodeHandshakePacket
+// 
+// Layout:
+// 'H'
+// varint: protocol version the engine will speak, at most the one we offered
+// varint: connect flags the engine accepted
+// ============================
+void Network::DecodeHandshakePacket( ENetPacket* packet, Engine& engine )
+{
+	PacketReader reader( packet->data + 1, packet->dataLength - 1 );
+
+	uint64_t version;
+	uint64_t acceptedFlags;
+	if ( reader.ReadVarint( version ) && reader.ReadVarint( acceptedFlags ) && version >= ProtocolVersion::Legacy )
+	{
+		engine.protocolVersion = static_cast<ProtocolVersion::Enum>( std::min<uint64_t>( version, ProtocolVersion::Latest ) );
+	}
+
+	enet_packet_destroy( packet );
+}
+
+// ============================
+// Network::DecodeMessagePacket
+// 
+// Layout, version 1:
+// 'M'
+// byte: message type
+// float: time in seconds
+// uint16: text length
+// bytes: text
+// 
+// Layout, version 2:
+// 'M'
+// byte: message type
+// varint: time in microseconds
+// varint: text length
+// bytes: text
+// ============================
+void Network::DecodeMessagePacket( ENetPacket* packet, Engine& engine )
+{
+	ConsoleMessage message;
+	if ( !DecodeMessage( packet->data + 1, packet->dataLength - 1, engine.protocolVersion, message ) )
+	{
+		enet_packet_destroy( packet );
+		return;
+	}
+
+	// The text stays in the packet, which travels along with the message
+	message.source = engine.source;
+	message.packet.reset( packet );
+	ToAppTime( engine, &message, 1U );
+
+	CountReceivedMessages( 1U );
+	onReceiveMessages( &message, 1U );
+}
+
+// ============================
+// Network::DecodeMessage
+// ============================
+bool Network::DecodeMessage( const uint8_t* data, size_t size, ProtocolVersion::Enum version, ConsoleMessage& outMessage )
+{
+	PacketReader reader( data, size );
+
+	uint8_t type;
+	uint64_t timeMicroseconds;
+	uint64_t length;
+	std::string_view text;
+	bool isValid = reader.ReadByte( type );
+	if ( version == ProtocolVersion::Legacy )
+	{
+		float timeSeconds;
+		uint16_t legacyLength;
+		isValid = isValid && reader.ReadFloat( timeSeconds ) && reader.ReadUint16( legacyLength );
+		// Negative and NaN times end up as 0
+		timeMicroseconds = timeSeconds > 0.0f ? uint64_t( double( timeSeconds ) * 1'000'000.0 ) : 0U;
+		length = legacyLength;
+	}
+	else
+	{
+		isValid = isValid && reader.ReadVarint( timeMicroseconds ) && reader.ReadVarint( length );
+	}
+
+	if ( !isValid || !reader.ReadString( length, text ) )
+	{
+		return false;
+	}
+
+	outMessage = ConsoleMessage( text, timeMicroseconds, static_cast<ConsoleMessageType::Enum>( type ) );
+	return true;
+}
+
+// ============================
+// Network::DecodeBatchPacket
+// 
+// Layout:
+// 'B'
+// then a batch, see DecodeBatch
+// ============================
+void Network::DecodeBatchPacket( ENetPacket* packet, Engine& engine )
+{
+	PacketReader reader( packet->data + 1, packet->dataLength - 1 );
+	receivedMessages.clear();
+
+	DecodeBatch( reader, engine.source, receivedMessages );
+	ToAppTime( engine, receivedMessages.data(), receivedMessages.size() );
+	SubmitReceivedMessages( packet );
+}
+
+// ============================
+// Network::DecodeUnreliablePacket
+// 
+// Layout:
+// 'U'
+// byte: stream, normally the message type
+// varint: sequence number, i.e. how many messages of this stream were sent before
+// then a batch, see DecodeBatch
+// 
+// These can get lost, the gaps in sequence numbers tell how many messages went missing
+// ============================
+void Network::DecodeUnreliablePacket( ENetPacket* packet, Engine& engine )
+{
+	PacketReader reader( packet->data + 1, packet->dataLength - 1 );
+	receivedMessages.clear();
+
+	uint8_t stream;
+	uint64_t sequence;
+	if ( !reader.ReadByte( stream ) || stream >= MaxUnreliableStreams || !reader.ReadVarint( sequence ) )
+	{
+		enet_packet_destroy( packet );
+		return;
+	}
+
+	// ENet throws away unreliable packets that arrive after a newer one, so the sequence
+	// only ever goes forward, unless the engine started over
+	uint64_t& nextSequence = engine.nextSequences[stream];
+	const uint64_t numLost = sequence > nextSequence ? sequence - nextSequence : 0U;
+	if ( numLost > 0U )
+	{
+		numMessagesLost += numLost;
+		receivedMessages.push_back( CreateStatusMessage( "$G[DevConsoleApp] " + std::to_string( numLost ) + " messages dropped",
+			engine.source ) );
+	}
+
+	const size_t firstDecoded = receivedMessages.size();
+	nextSequence = sequence + DecodeBatch( reader, engine.source, receivedMessages );
+	ToAppTime( engine, receivedMessages.data() + firstDecoded, receivedMessages.size() - firstDecoded );
+
+	// The marker goes right before the messages that revealed the gap
+	if ( numLost > 0U && receivedMessages.size() > 1U )
+	{
+		receivedMessages.front().timeSubmitted = receivedMessages[1].timeSubmitted;
+		receivedMessages.front().type = receivedMessages[1].type;
+	}
+
+	SubmitReceivedMessages( packet );
+}
+
+// ============================
+// Network::DecodeBatch
+// 
+// Layout:
+// varint: number of messages
+// varint: time of the first message, in microseconds
+// for each message:
+//     byte: message type
+//     varint: microseconds since the previous message
+//     varint: text length
+//     bytes: text
+// ============================
+uint64_t Network::DecodeBatch( PacketReader& reader, uint8_t source, std::vector<ConsoleMessage>& outMessages )
+{
+	uint64_t numMessages = 0U;
+	uint64_t timeMicroseconds = 0U;
+	if ( !reader.ReadVarint( numMessages ) || !reader.ReadVarint( timeMicroseconds ) )
+	{
+		return 0U;
+	}
+
+	for ( uint64_t i = 0U; i < numMessages; i++ )
+	{
+		uint8_t type;
+		uint64_t timeDelta;
+		uint64_t length;
+		std::string_view text;
+		if ( !reader.ReadByte( type )
+			|| !reader.ReadVarint( timeDelta )
+			|| !reader.ReadVarint( length )
+			|| !reader.ReadString( length, text ) )
+		{
+			// Truncated batch, keep what was decoded so far
+			break;
+		}
+
+		timeMicroseconds += timeDelta;
+		outMessages.emplace_back( text, timeMicroseconds, static_cast<ConsoleMessageType::Enum>( type ) );
+		outMessages.back().source = source;
+	}
+
+	return numMessages;
+}
+
+// ============================
+// Network::SubmitReceivedMessages
+// ============================
+void Network::SubmitReceivedMessages( ENetPacket* packet )
+{
+	if ( receivedMessages.empty() )
+	{
+		enet_packet_destroy( packet );
+		return;
+	}
+
+	// All the text points into the packet, the last message takes it along
+	receivedMessages.back().packet.reset( packet );
+
+	CountReceivedMessages( receivedMessages.size() );
+	onReceiveMessages( receivedMessages.data(), receivedMessages.size() );
+}
+
+// ============================
+// Network::DecodeCataloguePacket
+// 
+// Layout:
+// 'L' or 'l'
+// varint: number of entries
+// for each entry:
+//     varint: string length
+//     bytes: string, cvar_name#flags&value
+// ============================
+void Network::DecodeCataloguePacket( ENetPacket* packet, Engine& engine, bool isFullCatalogue )
+{
+	PacketReader reader( packet->data + 1, packet->dataLength - 1 );
+	AutocompleteRecords records;
+	DecodeRecords( reader, packet->dataLength, records );
+
+	enet_packet_destroy( packet );
+	// A full catalogue only replaces this engine's entries, never another's
+	onReceiveAutocomplete( std::move( records ), engine.source, isFullCatalogue );
+}
+
+// ============================
+// Network::DecodeAutocompletePacket
+// 
+// Layout:
+// 'a'
+// varint: id of the request this answers
+// then the same as a catalogue packet
+// ============================
+void Network::DecodeAutocompletePacket( ENetPacket* packet, Engine& engine )
+{
+	PacketReader reader( packet->data + 1, packet->dataLength - 1 );
+
+	// Either a newer request went out since, or the user kept typing and one is about to,
+	// whose reply will replace it anyway, no point in parsing it
+	uint64_t requestId;
+	if ( !reader.ReadVarint( requestId ) || requestId != inFlightAutocompleteId || requestId != latestAutocompleteId )
+	{
+		enet_packet_destroy( packet );
+		return;
+	}
+
+	AutocompleteRecords records;
+	DecodeRecords( reader, packet->dataLength, records );
+
+	enet_packet_destroy( packet );
+	// Fresh values for entries we already know, so they're merged in
+	onReceiveAutocomplete( std::move( records ), engine.source, false );
+}
+
+// ============================
+// Network::DecodeRecords
+// ============================
+void Network::DecodeRecords( PacketReader& reader, size_t packetSize, AutocompleteRecords& outRecords )
+{
+	uint64_t numEntries = 0U;
+	if ( !reader.ReadVarint( numEntries ) )
+	{
+		return;
+	}
+
+	// Don't trust the count for the reservation, a packet can't hold more entries than bytes
+	outRecords.Reserve( std::min<uint64_t>( numEntries, packetSize ) );
+	for ( uint64_t i = 0U; i < numEntries; i++ )
+	{
+		uint64_t length;
+		std::string_view entry;
+		if ( !reader.ReadVarint( length ) || !reader.ReadString( length, entry ) )
+		{
+			break;
+		}
+
+		// Malformed entries are skipped, the rest of the packet is still fine
+		outRecords.Add( entry );
+	}
 }
 
 // ============================
 // Network::EncodeMessage
 // ============================
-std::vector<byte> Network::EncodeMessage( std::string_view message )
+bool Network::EncodeMessage( std::string_view message, ProtocolVersion::Enum version, std::vector<byte>& bytes )
 {
-	std::vector<byte> bytes;
-	bytes.reserve( 1 + 1 + message.size() );
+	// Version 1 has a single byte for the length, rather refuse than cut the command short
+	if ( version == ProtocolVersion::Legacy && message.size() > 255U )
+	{
+		return false;
+	}
 
+	PacketWriter writer( bytes );
 	// 1st byte: message type (C = concommand)
-	bytes.push_back( 'C' );
-	// 3rd byte: string length
-	bytes.push_back( message.size() );
-
-	// rest: string data
-	for ( int i = 0; i < message.size(); i++ )
+	writer.WriteByte( 'C' );
+	// then the string length, a byte in version 1, a varint from version 2 on
+	if ( version == ProtocolVersion::Legacy )
+	{
+		writer.WriteByte( uint8_t( message.size() ) );
+	}
+	else
 	{
-		bytes.push_back( message[i] );
+		writer.WriteVarint( message.size() );
 	}
 
-	return bytes;
+	// rest: string data
+	writer.WriteString( message );
+	return true;
 }
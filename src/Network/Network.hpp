@@ -4,14 +4,88 @@
 #pragma once
 
 struct ConsoleMessage;
+struct AutocompleteRecords;
+class PacketReader;
+
+// ENet delivers each channel in order independently of the others,
+// so a backlog of logs can't hold up a command or its reply
+struct NetworkChannel final
+{
+	enum Enum : uint8_t
+	{
+		// Engine -> app: 'M' and 'B' log packets, and 'X'
+		Logs = 0,
+		// App -> engine: 'C' command packets, reliable, and whatever the engine answers with
+		Commands = 1,
+		// Both ways: 'L'/'l' catalogue and 'A'/'a' autocomplete requests and replies
+		Autocomplete = 2,
+		// Engine -> app: 'U' packets, unreliable, so Verbose and Developer spam never gets resent
+		UnreliableLogs = 3,
+
+		Count
+	};
+};
+
+// Sent as the data of the connection request, tells the engine what this app can handle
+// The lower 16 bits are flags, the upper 16 bits the newest protocol version the app speaks
+struct ConnectFlag final
+{
+	enum Enum : uint32_t
+	{
+		// Verbose and Developer messages may come as 'U' packets, everything else stays reliable
+		UnreliableLogs = 1U << 0
+	};
+
+	static constexpr uint32_t VersionShift = 16U;
+};
+
+// Version 1: the original format, 'M' packets with a float time and a 16-bit length,
+// 'C' records with an 8-bit length. Engines that don't answer with an 'H' packet speak this.
+// Version 2: varint lengths and 64-bit microsecond timestamps everywhere
+struct ProtocolVersion final
+{
+	enum Enum : uint32_t
+	{
+		Legacy = 1,
+		Varint = 2,
+
+		Latest = Varint
+	};
+};
 
 class Network final
 {
 public:
-	// Called whenever a log message is received
-	using OnReceiveMessageFn = void( const ConsoleMessage& message );
-	// Called whenever a list of autocomplete options is received
-	using OnReceiveAutocompleteFn = void( const std::vector<std::string>& autocompleteStrings );
+	// Called whenever log messages are received, usually all messages from one packet
+	// Message text points into the packet, which the last message owns. The callee moves
+	// the messages out to keep them, whatever is left in them is freed once it returns
+	using OnReceiveMessagesFn = void( ConsoleMessage* messages, size_t numMessages );
+	// Called when an engine's cvar/command catalogue arrives, or when it registers new entries
+	// Entries are parsed on the network thread, an empty full catalogue means the engine was lost
+	using OnReceiveAutocompleteFn = void( AutocompleteRecords&& records, uint8_t source, bool isFullCatalogue );
+
+	// 'U' packets carry a stream number below this, normally the message type
+	static constexpr size_t MaxUnreliableStreams = 8U;
+
+	// Commands with this target go to every connected engine
+	static constexpr size_t BroadcastTarget = 0U;
+	// Engines are numbered from 1, like ConsoleMessage::source, 0 being the app itself
+	static constexpr size_t MaxEngines = 255U;
+	static constexpr uint16_t DefaultPort = 23005U;
+
+	// Running totals since Init, and how the connections are doing right now
+	struct Statistics
+	{
+		// Log messages and bytes of every packet received from the engines
+		uint64_t messagesReceived;
+		uint64_t bytesReceived;
+		// Known to be lost in unreliable mode
+		uint64_t messagesLost;
+		// Averaged over the connected engines, as measured by ENet
+		uint32_t roundTripTime;
+		float packetLoss;
+		size_t numConnected;
+	};
 
 	enum class State
 	{
@@ -22,39 +96,230 @@ public:
 	};
 
 public:
-	bool Init( std::function<OnReceiveMessageFn> receiveMessage,
+	// Endpoints are "host" or "host:port", one per engine
+	bool Init( const std::vector<std::string>& endpoints,
+		std::function<OnReceiveMessagesFn> receiveMessages,
 		std::function<OnReceiveAutocompleteFn> receiveAutocomplete );
 	void Shutdown();
 	void Update();
 
-	void RequestAutocompleteUpdate( std::string_view command );
-
 	bool IsActive() const
 	{
-		return state == State::Inactive;
+		return running;
 	}
 
-	void SubmitCommand( std::string_view command );
+	size_t GetNumEngines() const
+	{
+		return engines.size();
+	}
+
+	// Whether to offer engines the unreliable mode for Verbose and Developer messages, on by default
+	// Must be called before Init
+	void SetAllowUnreliableLogs( bool allow )
+	{
+		allowUnreliableLogs = allow;
+	}
+
+	// Messages known to be lost in unreliable mode, over all engines
+	uint64_t GetNumMessagesLost() const
+	{
+		return numMessagesLost;
+	}
+
+	// Can be called from any thread, the connection figures are at most one update old
+	Statistics GetStatistics() const;
+
+	// Queues a command to be sent to the engine with the given number, or to all of them,
+	// can be called from any thread
+	// The future becomes true once every engine it went to has acknowledged receiving it,
+	// or false if a connection was lost before that
+	std::future<bool> SubmitCommand( std::string_view command, size_t target = BroadcastTarget );
+
+	// Asks the engines for up-to-date values of everything starting with prefix, can be called from any thread
+	// The request only goes out once typing pauses, and it supersedes any earlier one,
+	// so replies to older prefixes are dropped before they reach the callback
+	void RequestAutocomplete( std::string_view prefix );
+
+	// Decodes the body of an 'M' packet, everything after the packet type, in the given protocol version
+	// The text points into data, returns false if the packet is malformed
+	static bool DecodeMessage( const uint8_t* data, size_t size, ProtocolVersion::Enum version, ConsoleMessage& outMessage );
+	// Appends the messages of a batch to outMessages, returns how many the header said there are
+	static uint64_t DecodeBatch( PacketReader& reader, uint8_t source, std::vector<ConsoleMessage>& outMessages );
 
 private:
-	void UpdateWhileConnecting();
-	void UpdateWhileConnected();
-	void UpdateWhileDisconnecting();
+	// One connection to an instance of Elegy Engine
+	struct Engine
+	{
+		// As given on the command line
+		std::string name;
+		ENetAddress address;
+		ENetPeer* peer;
+		State state;
+		// Tag for messages coming from this engine
+		uint8_t source;
+		// While inactive, when to try connecting again
+		float reconnectTime;
+		// Sequence number the next 'U' packet of each stream should start at
+		std::array<uint64_t, MaxUnreliableStreams> nextSequences;
+		// Agreed on in the handshake
+		ProtocolVersion::Enum protocolVersion;
+		// The last attempt failed, retries only report that they failed too,
+		// so the history folds them into a single line
+		bool isRetrying;
+		// Added to the engine's message times to put them on the app's clock, set once per connection
+		int64_t clockOffset;
+		bool hasClockOffset;
+	};
+
+	// Shared by every packet a command went out in, resolved once the last of them is freed
+	struct CommandDelivery
+	{
+		std::promise<bool> promise;
+		size_t numPending;
+		bool delivered;
+	};
+
+	struct PendingCommand
+	{
+		std::string command;
+		size_t target;
+		std::shared_ptr<CommandDelivery> delivery;
+	};
+
+	// Commands that went out together in one packet, owned by the packet
+	struct CommandBatch
+	{
+		std::vector<std::shared_ptr<CommandDelivery>> deliveries;
+	};
+
+	void Connect( Engine& engine );
+	void OnConnected( Engine& engine );
+	// The connection attempt failed, or an established connection was lost
+	void OnDisconnected( Engine& engine );
+	void OnReceive( Engine& engine, ENetPacket* packet );
+	bool IsAnyEngineConnected() const;
+	// Copies ENet's round-trip time and packet loss figures out of the peers, for GetStatistics
+	void SampleConnections();
+	// Milliseconds until an engine is due to reconnect, or ENet has to resend, time out or ping on its connection
+	uint32_t GetHousekeepingTimeout() const;
+	// Right before log messages are handed over
+	void CountReceivedMessages( size_t numMessages );
+	// Only the network thread writes to the counters, so they don't need an atomic add
+	static void AddToCounter( std::atomic<uint64_t>& counter, uint64_t amount )
+	{
+		counter.store( counter.load( std::memory_order_relaxed ) + amount, std::memory_order_relaxed );
+	}
+
+	// Sends every queued command, one packet per engine, or per command for engines older than ProtocolVersion::Varint
+	void FlushCommands();
+	// Sends the commands encoded into commandPacketBytes as one packet, which takes ownership of the batch
+	void SendCommandPacket( Engine& engine, CommandBatch* batch );
+	// Resolves all queued commands as not delivered
+	void FailPendingCommands();
+	// One of the packets a command went out in was freed
+	static void ResolveDelivery( CommandDelivery& delivery, bool delivered );
+	// ENet calls this once a command packet is acknowledged or thrown away
+	static void ENET_CALLBACK OnCommandPacketFreed( ENetPacket* packet );
+
+	// The channel to send on, older bridges may have accepted fewer channels than we asked for
+	static enet_uint8 GetChannel( const ENetPeer* peer, NetworkChannel::Enum channel );
+
+	// Blocks until a packet arrives, WakeNetworkThread is called, or the timeout expires
+	void WaitForNetworkActivity( uint32_t timeoutMilliseconds );
+	// Makes WaitForNetworkActivity return right away, can be called from any thread
+	void WakeNetworkThread();
+
+	// Asks the engine for every cvar and command, it follows up with new ones by itself
+	void RequestAutocompleteCatalogue( Engine& engine );
+	// Sends the pending autocomplete request if typing has paused for long enough
+	// Returns how many milliseconds are left until it's due, or MaxWaitMilliseconds if there's none
+	uint32_t FlushAutocompleteRequest();
 
-	static std::vector<byte> EncodeMessage( std::string_view message );
+	// Logs a message of our own, the text is copied
+	void ReportStatus( std::string_view text, uint8_t source = 0U );
+	// The message carries a copy of the text, timed by the app's clock
+	static ConsoleMessage CreateStatusMessage( std::string_view text, uint8_t source );
+	// Engines time their messages from their own startup, the app's own messages from the app's
+	// Moves decoded messages onto the app's clock, so messages from everywhere can be merged by time
+	static void ToAppTime( Engine& engine, ConsoleMessage* messages, size_t numMessages );
+
+	// 'H' packet: the engine's half of the handshake
+	void DecodeHandshakePacket( ENetPacket* packet, Engine& engine );
+	// 'M' packet: a single log message
+	void DecodeMessagePacket( ENetPacket* packet, Engine& engine );
+	// 'B' packet: a batch of log messages sharing one header
+	void DecodeBatchPacket( ENetPacket* packet, Engine& engine );
+	// 'U' packet: a batch of log messages from an unreliable stream
+	void DecodeUnreliablePacket( ENetPacket* packet, Engine& engine );
+	// Hands receivedMessages over, the last one takes the packet along
+	void SubmitReceivedMessages( ENetPacket* packet );
+	// 'L' packet: the whole autocomplete catalogue, 'l' packet: newly registered entries
+	void DecodeCataloguePacket( ENetPacket* packet, Engine& engine, bool isFullCatalogue );
+	// 'a' packet: reply to an autocomplete request
+	void DecodeAutocompletePacket( ENetPacket* packet, Engine& engine );
+	// Reads a varint count followed by that many catalogue entries
+	static void DecodeRecords( PacketReader& reader, size_t packetSize, AutocompleteRecords& outRecords );
+
+	// Appends a 'C' record to the packet, returns false if the message can't be encoded in this version
+	static bool EncodeMessage( std::string_view message, ProtocolVersion::Enum version, std::vector<byte>& bytes );
 
 private:
-	std::string command{};
-	bool sendCommand{ false };
-	std::string autocompleteCommand{};
-	bool requestAutocomplete{ false };
-	State state{ State::Inactive };
+	// Longest the network thread sleeps when nothing is due, everything else wakes it up
+	static constexpr uint32_t MaxWaitMilliseconds = 1000U;
+	// How long typing has to pause before an autocomplete request goes out
+	static constexpr float AutocompleteDebounceSeconds = 0.15f;
+	// An engine that doesn't answer within this is considered not running
+	static constexpr uint32_t ConnectTimeoutMilliseconds = 1500U;
+	static constexpr float ReconnectDelaySeconds = 0.5f;
+
+	// Guards pendingCommands
+	std::mutex commandMutex;
+	std::vector<PendingCommand> pendingCommands{};
+	// Network thread only, swapped with pendingCommands so the lock is held briefly
+	std::vector<PendingCommand> commandsToSend{};
+	// Commands whose engines aren't connected yet, they go back into the queue
+	std::vector<PendingCommand> commandsToKeep{};
+	std::vector<byte> commandPacketBytes{};
+
+	// Guards the three below
+	std::mutex autocompleteMutex;
+	// Only the newest request is kept, a new one simply overwrites it
+	std::string pendingAutocompletePrefix{};
+	bool hasPendingAutocomplete{ false };
+	float autocompleteDueTime{ 0.0f };
+	// Id of the newest request, a reply carrying any other id is stale
+	std::atomic<uint32_t> latestAutocompleteId{ 0U };
+	// Id of the request that went out last, only touched by the network thread
+	// Replies to anything sent before it are dropped, so only one request is ever in flight
+	uint32_t inFlightAutocompleteId{ 0U };
+	std::vector<byte> autocompletePacketBytes{};
 
+	bool allowUnreliableLogs{ true };
+	std::atomic<uint64_t> numMessagesLost{ 0U };
+	std::atomic<uint64_t> numMessagesReceived{ 0U };
+	std::atomic<uint64_t> numBytesReceived{ 0U };
+	// Written by SampleConnections, packet loss is a fraction of ENET_PEER_PACKET_LOSS_SCALE
+	std::atomic<uint32_t> averageRoundTripTime{ 0U };
+	std::atomic<uint32_t> averagePacketLoss{ 0U };
+	std::atomic<uint32_t> numConnectedEngines{ 0U };
+	// Since startup, in microseconds, it's reported once
+	uint64_t firstMessageTime{ 0U };
+	bool hasReportedFirstMessage{ false };
+
+	std::atomic<bool> running{ false };
 	std::thread networkThread;
-	ENetAddress consoleBridgeAddress{};
 	ENetHost* consoleAppHost{ nullptr };
-	ENetPeer* consoleBridgePeer{ nullptr };
+	// Never resized after Init, peers point back at their engine
+	std::vector<Engine> engines{};
+
+	// Sends a tiny datagram to our own host socket to interrupt WaitForNetworkActivity
+	// ENet discards it as it's too short to carry a protocol header
+	ENetSocket wakeSocket{ ENET_SOCKET_NULL };
+	ENetAddress wakeAddress{};
+
+	// Reused for decoding, so receiving doesn't allocate per message
+	std::vector<ConsoleMessage> receivedMessages{};
 
-	std::function<OnReceiveMessageFn> onReceiveMessage{};
+	std::function<OnReceiveMessagesFn> onReceiveMessages{};
 	std::function<OnReceiveAutocompleteFn> onReceiveAutocomplete{};
 };
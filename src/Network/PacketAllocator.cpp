@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+#include "PacketAllocator.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+namespace
+{
+	// ENet allocates a lot of small command structures and MTU-sized buffers,
+	// and packets big enough to be fragmented go to the system allocator
+	constexpr size_t SizeClasses[] = { 32U, 64U, 128U, 256U, 512U, 1024U, 2048U, 4096U };
+	constexpr size_t NumSizeClasses = sizeof( SizeClasses ) / sizeof( SizeClasses[0] );
+	constexpr uint32_t SystemSizeClass = UINT32_MAX;
+	constexpr size_t SlabSize = 64U * 1024U;
+
+	// Sits in front of every block, keeps the payload aligned like malloc would
+	struct alignas( alignof( std::max_align_t ) ) BlockHeader
+	{
+		size_t size;
+		uint32_t sizeClass;
+	};
+
+	// Overlaid onto the payload of blocks that are in a free list
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	struct Pool
+	{
+		std::mutex mutex;
+		FreeBlock* freeLists[NumSizeClasses]{};
+
+		std::atomic<size_t> liveBytes{ 0U };
+		std::atomic<size_t> pooledBytes{ 0U };
+		std::atomic<size_t> numAllocations{ 0U };
+		std::atomic<size_t> numFrees{ 0U };
+		std::atomic<size_t> numSystemAllocations{ 0U };
+		std::atomic<bool> isEnabled{ true };
+	};
+
+	// Intentionally leaked, packets may still be destroyed during static destruction
+	Pool& GetPool()
+	{
+		static Pool* pool = new Pool();
+		return *pool;
+	}
+
+	uint32_t FindSizeClass( size_t size )
+	{
+		for ( uint32_t i = 0U; i < NumSizeClasses; i++ )
+		{
+			if ( size <= SizeClasses[i] )
+			{
+				return i;
+			}
+		}
+
+		return SystemSizeClass;
+	}
+
+	// Carves a new slab into free blocks, expects the pool to be locked
+	void RefillFreeList( Pool& pool, uint32_t sizeClass )
+	{
+		const size_t blockSize = sizeof( BlockHeader ) + SizeClasses[sizeClass];
+		const size_t numBlocks = std::max<size_t>( 1U, SlabSize / blockSize );
+
+		char* slab = static_cast<char*>( std::malloc( numBlocks * blockSize ) );
+		if ( nullptr == slab )
+		{
+			return;
+		}
+
+		for ( size_t i = 0U; i < numBlocks; i++ )
+		{
+			auto* header = reinterpret_cast<BlockHeader*>( slab + i * blockSize );
+			header->sizeClass = sizeClass;
+
+			auto* block = reinterpret_cast<FreeBlock*>( header + 1 );
+			block->next = pool.freeLists[sizeClass];
+			pool.freeLists[sizeClass] = block;
+		}
+
+		pool.pooledBytes += numBlocks * blockSize;
+	}
+}
+
+// ============================
+// PacketAllocator::InitialiseEnet
+// ============================
+int PacketAllocator::InitialiseEnet()
+{
+	ENetCallbacks callbacks{};
+	callbacks.malloc = &PacketAllocator::Allocate;
+	callbacks.free = &PacketAllocator::Free;
+	callbacks.no_memory = nullptr;
+
+	return enet_initialize_with_callbacks( ENET_VERSION, &callbacks );
+}
+
+// ============================
+// PacketAllocator::SetPoolEnabled
+// ============================
+void PacketAllocator::SetPoolEnabled( bool enabled )
+{
+	GetPool().isEnabled = enabled;
+}
+
+// ============================
+// PacketAllocator::GetStatistics
+// ============================
+PacketAllocator::Statistics PacketAllocator::GetStatistics()
+{
+	const Pool& pool = GetPool();
+	return
+	{
+		pool.liveBytes,
+		pool.pooledBytes,
+		pool.numAllocations,
+		pool.numFrees,
+		pool.numSystemAllocations
+	};
+}
+
+// ============================
+// PacketAllocator::Allocate
+// ============================
+void* ENET_CALLBACK PacketAllocator::Allocate( size_t size )
+{
+	Pool& pool = GetPool();
+	const uint32_t sizeClass = pool.isEnabled ? FindSizeClass( size ) : SystemSizeClass;
+
+	BlockHeader* header = nullptr;
+	if ( sizeClass == SystemSizeClass )
+	{
+		header = static_cast<BlockHeader*>( std::malloc( sizeof( BlockHeader ) + size ) );
+		if ( nullptr == header )
+		{
+			return nullptr;
+		}
+
+		header->sizeClass = SystemSizeClass;
+		pool.numSystemAllocations++;
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock( pool.mutex );
+		if ( nullptr == pool.freeLists[sizeClass] )
+		{
+			RefillFreeList( pool, sizeClass );
+			if ( nullptr == pool.freeLists[sizeClass] )
+			{
+				return nullptr;
+			}
+		}
+
+		FreeBlock* block = pool.freeLists[sizeClass];
+		pool.freeLists[sizeClass] = block->next;
+		header = reinterpret_cast<BlockHeader*>( block ) - 1;
+	}
+
+	header->size = size;
+	pool.liveBytes += size;
+	pool.numAllocations++;
+	return header + 1;
+}
+
+// ============================
+// PacketAllocator::Free
+// ============================
+void ENET_CALLBACK PacketAllocator::Free( void* memory )
+{
+	if ( nullptr == memory )
+	{
+		return;
+	}
+
+	Pool& pool = GetPool();
+	BlockHeader* header = static_cast<BlockHeader*>( memory ) - 1;
+	pool.liveBytes -= header->size;
+	pool.numFrees++;
+
+	if ( header->sizeClass == SystemSizeClass )
+	{
+		std::free( header );
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( pool.mutex );
+	auto* block = static_cast<FreeBlock*>( memory );
+	block->next = pool.freeLists[header->sizeClass];
+	pool.freeLists[header->sizeClass] = block;
+}
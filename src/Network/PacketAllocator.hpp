@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// ============================
+// PacketAllocator
+// 
+// Size-class pool allocator that ENet uses for packets, commands and fragments
+// Small blocks are carved out of slabs and recycled through free lists,
+// anything bigger than the largest size class goes to the system allocator
+// 
+// Packets get destroyed on the UI thread too, so it's thread-safe
+// Slabs are never returned to the system, the pool stays at its peak size
+// ============================
+class PacketAllocator final
+{
+public:
+	struct Statistics
+	{
+		// Bytes currently handed out to ENet
+		size_t liveBytes;
+		// Bytes reserved in slabs, used or not
+		size_t pooledBytes;
+		// Running totals, sample them over time to get a rate
+		size_t numAllocations;
+		size_t numFrees;
+		// Allocations that were too big for the pool
+		size_t numSystemAllocations;
+	};
+
+public:
+	// Use instead of enet_initialize
+	static int InitialiseEnet();
+	// With the pool off, every allocation goes to the system allocator like with plain enet_initialize,
+	// so the two can be compared in one process. Blocks from before the switch can still be freed.
+	static void SetPoolEnabled( bool enabled );
+
+	static Statistics GetStatistics();
+
+	static void* ENET_CALLBACK Allocate( size_t size );
+	static void ENET_CALLBACK Free( void* memory );
+};
@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstring>
+
+// ============================
+// PacketReader
+// 
+// Reads fields off a received packet, front to back
+// Every read is bounds-checked and returns false once the packet runs out,
+// so truncated or malformed packets can't make us read past the end
+// ============================
+class PacketReader final
+{
+public:
+	PacketReader( const uint8_t* packetData, size_t packetSize )
+		: data( packetData ), size( packetSize )
+	{
+	}
+
+	bool ReadByte( uint8_t& outValue )
+	{
+		if ( position >= size )
+		{
+			return false;
+		}
+
+		outValue = data[position++];
+		return true;
+	}
+
+	// Fixed-size fields are little-endian, no matter what this machine is
+	bool ReadUint16( uint16_t& outValue )
+	{
+		if ( size - position < 2U )
+		{
+			return false;
+		}
+
+		outValue = uint16_t( data[position] | (data[position + 1] << 8) );
+		position += 2U;
+		return true;
+	}
+
+	bool ReadUint32( uint32_t& outValue )
+	{
+		if ( size - position < 4U )
+		{
+			return false;
+		}
+
+		outValue = uint32_t( data[position] )
+			| (uint32_t( data[position + 1] ) << 8)
+			| (uint32_t( data[position + 2] ) << 16)
+			| (uint32_t( data[position + 3] ) << 24);
+		position += 4U;
+		return true;
+	}
+
+	// IEEE 754 single precision, sent as its little-endian bit pattern
+	bool ReadFloat( float& outValue )
+	{
+		uint32_t bits;
+		if ( !ReadUint32( bits ) )
+		{
+			return false;
+		}
+
+		static_assert( sizeof( float ) == sizeof( uint32_t ) );
+		std::memcpy( &outValue, &bits, sizeof( outValue ) );
+		return true;
+	}
+
+	// Unsigned LEB128: 7 bits per byte, lowest bits first,
+	// the top bit is set on every byte except the last one
+	bool ReadVarint( uint64_t& outValue )
+	{
+		outValue = 0U;
+		for ( int shift = 0; shift < 64; shift += 7 )
+		{
+			uint8_t value;
+			if ( !ReadByte( value ) )
+			{
+				return false;
+			}
+
+			outValue |= uint64_t( value & 0x7F ) << shift;
+			if ( !(value & 0x80) )
+			{
+				return true;
+			}
+		}
+
+		// More than 10 bytes, this isn't a valid varint
+		return false;
+	}
+
+	// The view points into the packet, it's only valid for as long as the packet is
+	bool ReadString( size_t length, std::string_view& outValue )
+	{
+		if ( length > size - position )
+		{
+			return false;
+		}
+
+		outValue = std::string_view( reinterpret_cast<const char*>( data + position ), length );
+		position += length;
+		return true;
+	}
+
+	bool IsAtEnd() const
+	{
+		return position >= size;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t position{ 0U };
+};
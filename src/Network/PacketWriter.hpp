@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstring>
+
+// ============================
+// PacketWriter
+// 
+// Appends fields to a packet being built, the counterpart of PacketReader
+// Fixed-size fields are little-endian, no matter what this machine is
+// ============================
+class PacketWriter final
+{
+public:
+	PacketWriter( std::vector<uint8_t>& packetBytes )
+		: bytes( packetBytes )
+	{
+	}
+
+	void WriteByte( uint8_t value )
+	{
+		bytes.push_back( value );
+	}
+
+	void WriteUint16( uint16_t value )
+	{
+		bytes.push_back( uint8_t( value ) );
+		bytes.push_back( uint8_t( value >> 8 ) );
+	}
+
+	void WriteUint32( uint32_t value )
+	{
+		for ( int shift = 0; shift < 32; shift += 8 )
+		{
+			bytes.push_back( uint8_t( value >> shift ) );
+		}
+	}
+
+	void WriteFloat( float value )
+	{
+		uint32_t bits;
+		std::memcpy( &bits, &value, sizeof( bits ) );
+		WriteUint32( bits );
+	}
+
+	// Unsigned LEB128: 7 bits per byte, lowest bits first,
+	// the top bit is set on every byte except the last one
+	void WriteVarint( uint64_t value )
+	{
+		while ( value >= 0x80 )
+		{
+			bytes.push_back( uint8_t( value & 0x7F ) | 0x80 );
+			value >>= 7;
+		}
+
+		bytes.push_back( uint8_t( value ) );
+	}
+
+	// Just the bytes, the length is up to the caller
+	void WriteString( std::string_view value )
+	{
+		bytes.insert( bytes.end(), value.begin(), value.end() );
+	}
+
+private:
+	std::vector<uint8_t>& bytes;
+};
@@ -11,7 +11,10 @@
 
 #include <enet/enet.h>
 
+#include <algorithm>
 #include <functional>
+#include <future>
+#include <mutex>
 #include <thread>
 #include <string>
 #include <vector>
@@ -21,3 +24,5 @@
 void Wait( float seconds );
 
 float Now();
+// Same clock as Now, for message timestamps
+uint64_t NowMicroseconds();
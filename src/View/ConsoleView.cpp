@@ -4,6 +4,7 @@
 #include "Precompiled.hpp"
 
 #include "ConsoleView.hpp"
+#include "MessageLinesNode.hpp"
 #include <chrono>
 namespace chrono = std::chrono;
 
@@ -32,6 +33,29 @@ namespace chrono = std::chrono;
 // ============================
 void ConsoleView::Init( std::function<OnCommandSubmitFn> commandSubmit,
 	std::function<OnAutocompleteRequestFn> autocompleteRequest )
+{
+	InitOffscreen( commandSubmit, autocompleteRequest );
+	isInteractive = true;
+
+	std::future<void> firstFrame = firstFrameDrawn.get_future();
+	listenerThread = std::thread( [&]
+		{
+			AddMessage( { "$y[DevConsoleApp] $gInitialised developer console app" } );
+			AddMessage( { "$y[DevConsoleApp] $gType '!quit' to quit this console" } );
+
+			screen.Loop( mainComponent );
+		} );
+
+	// Logging works before this too, it only gets shown once the loop runs, so a terminal that
+	// never draws shouldn't keep the network from starting
+	firstFrame.wait_for( FirstFrameTimeout );
+}
+
+// ============================
+// ConsoleView::InitOffscreen
+// ============================
+void ConsoleView::InitOffscreen( std::function<OnCommandSubmitFn> commandSubmit,
+	std::function<OnAutocompleteRequestFn> autocompleteRequest )
 {
 	onCommandSubmit = commandSubmit;
 	onAutocompleteRequest = autocompleteRequest;
@@ -50,22 +74,16 @@ void ConsoleView::Init( std::function<OnCommandSubmitFn> commandSubmit,
 
 	inputFieldComponent = Input( &userInput, "[enter your command here]" );
 
-	messageFrameComponent = Renderer( [&]
+	// Only the messages around the visible part of the history get turned into Elements
+	messageScrollerComponent = Scroller( [&]
 		{
-			isRenderingMessages = true;
+			return ScrollerRange{ messages.Begin(), messages.End() };
+		},
 
-			Elements consoleMessageElements{};
-			const size_t numMessagesThisMoment = messages.size();
-			for ( size_t i = 0U; i < numMessagesThisMoment; i++ )
-			{
-				consoleMessageElements.emplace_back( ConsoleMessageToFtxElement( messages[i] ));
-			}
-
-			isRenderingMessages = false;
-
-			return vbox( std::move( consoleMessageElements ) );
+		[&]( size_t first, size_t last )
+		{
+			return MessageLines( messages, first, last, showSources, &search );
 		} );
-	messageScrollerComponent = Scroller( messageFrameComponent );
 
 	containerComponent = Container::Vertical( { messageScrollerComponent, inputFieldComponent } );
 	containerComponent |= CatchEvent( [&]( Event e ) 
@@ -75,9 +93,35 @@ void ConsoleView::Init( std::function<OnCommandSubmitFn> commandSubmit,
 
 	mainComponent = Renderer( containerComponent, [&]
 		{
-			return vbox(
+			framePacer.BeginFrame();
+
+			// Sampled before draining, so the queue depth shows what piled up since the last frame
+			// Only every SampleIntervalMicroseconds, the figures wouldn't change in between anyway
+			const uint64_t frameTime = NowMicroseconds();
+			if ( showStatistics && statsStrip.IsDue( frameTime ) )
+			{
+				statsStrip.Update( GetStatisticsSample(), frameTime );
+			}
+
+			const size_t numDrained = DrainIncomingMessages();
+			search.Update();
+			if ( jumpToBottom && !search.IsActive() )
+			{
+				// Straight to the scroller, rather than posting an End event that would take another frame
+				messageScrollerComponent->OnEvent( Event::End );
+				jumpToBottom = false;
+			}
+
+			if ( !hasDrawnFrame )
+			{
+				hasDrawnFrame = true;
+				firstFrameDrawn.set_value();
+			}
+
+			Element frame = vbox(
 				{
 					consoleTitleComponent->Render(),
+					showStatistics ? statsStrip.Render() : emptyElement(),
 
 					separatorLight(),
 					// A dbox allows us to draw components *over* each other
@@ -111,25 +155,21 @@ void ConsoleView::Init( std::function<OnCommandSubmitFn> commandSubmit,
 					hbox(
 					{
 						text( "> " ),
-						inputFieldComponent->Render() | focus | size( HEIGHT, EQUAL, 1 )
+						inputFieldComponent->Render() | focus | size( HEIGHT, EQUAL, 1 ) | flex,
+						RenderSearchStatus()
 					})
 				} ) | borderDouble;
-		} );
-
-	Wait( 0.1f );
-
-	listenerThread = std::thread( [&]
-		{
-			// Don't immediately render text, wait for a little bit
-			Wait( 0.1f );
 
-			OnLog( { "$y[DevConsoleApp] $gInitialised developer console app" } );
-			OnLog( { "$y[DevConsoleApp] $gType '!quit' to quit this console" } );
-
-			screen.Loop( mainComponent );
+			return framePacer.TimeFrame( std::move( frame ), numDrained, isInteractive ? &screen : nullptr );
 		} );
+}
 
-	Wait( 0.1f );
+// ============================
+// ConsoleView::RenderOffscreen
+// ============================
+void ConsoleView::RenderOffscreen( Screen& target )
+{
+	Render( target, mainComponent->Render() );
 }
 
 // ============================
@@ -138,68 +178,321 @@ void ConsoleView::Init( std::function<OnCommandSubmitFn> commandSubmit,
 void ConsoleView::Shutdown()
 {
 	stopListening = true;
+	RequestRedraw();
 	screen.Post( [&]
 		{
 			screen.ExitLoopClosure()();
 		} );
 	listenerThread.join();
+
+	// Whatever the last frame didn't get to still owns packets and text
+	ConsoleMessage message{};
+	while ( incomingMessages.TryPop( message ) )
+	{
+		message.ReleaseText();
+	}
+}
+
+// ============================
+// ConsoleView::OnLog
+// ============================
+void ConsoleView::OnLog( ConsoleMessage&& message )
+{
+	OnLog( &message, 1U );
 }
 
 // ============================
 // ConsoleView::OnLog
 // ============================
-void ConsoleView::OnLog( const ConsoleMessage& message )
+void ConsoleView::OnLog( ConsoleMessage* logMessages, size_t numMessages )
 {
-	while ( isRenderingMessages )
+	// Messages from one packet are queued all together or not at all, so the
+	// packet is either handed over with the last one, or can be destroyed right here
+	// Rather lose them than stall the network thread
+	if ( incomingMessages.FreeSpace() < numMessages )
 	{
-		Wait( 0.001f );
+		numDroppedMessages += numMessages;
+		for ( size_t i = 0U; i < numMessages; i++ )
+		{
+			logMessages[i].ReleaseText();
+		}
+		return;
 	}
 
-	// Horrifically unoptimised, we should use a ring buffer
-	// However, it'll work for now
-	if ( messages.size() == 1024U )
+	for ( size_t i = 0U; i < numMessages; i++ )
 	{
-		messages.erase( messages.begin() );
+		incomingMessages.TryPush( std::move( logMessages[i] ) );
 	}
-	messages.push_back( message );
-	
-	timeToUpdate = -1.0f; // update and scroll all the way down
-	jumpToBottom = true;
+
+	RequestRedraw();
 }
 
 // ============================
-// ConsoleView::OnUpdate
+// ConsoleView::DrainIncomingMessages
 // ============================
-bool ConsoleView::OnUpdate( const float& deltaTime )
+size_t ConsoleView::DrainIncomingMessages()
 {
-	if ( executeCommand )
+	// Each engine's messages arrive in order, but different engines are interleaved
+	// however the packets happened to come in, so they're sorted out per engine first
+	ConsoleMessage message{};
+	size_t numReceived = 0U;
+	while ( incomingMessages.TryPop( message ) )
 	{
-		ConsumeCommand();
-		executeCommand = false;
+		if ( message.source >= messagesBySource.size() )
+		{
+			messagesBySource.resize( message.source + 1U );
+		}
+
+		messagesBySource[message.source].push_back( std::move( message ) );
+		numReceived++;
 	}
 
-	if ( stopListening )
+	if ( numReceived == 0U )
 	{
-		return false;
+		return 0U;
+	}
+
+	// The spinner only turns while messages are coming in
+	animationFrame++;
+
+	// K-way merge on the time, there are only ever a few engines, so a linear
+	// scan for the earliest one is cheaper than maintaining a heap
+	// Every engine keeps its own order, so a packet still travels with the last of its messages
+	mergePositions.assign( messagesBySource.size(), 0U );
+	while ( true )
+	{
+		size_t earliest = messagesBySource.size();
+		for ( size_t source = 0U; source < messagesBySource.size(); source++ )
+		{
+			if ( mergePositions[source] >= messagesBySource[source].size() )
+			{
+				continue;
+			}
+
+			if ( earliest == messagesBySource.size()
+				|| messagesBySource[source][mergePositions[source]].timeSubmitted
+				< messagesBySource[earliest][mergePositions[earliest]].timeSubmitted )
+			{
+				earliest = source;
+			}
+		}
+
+		if ( earliest == messagesBySource.size() )
+		{
+			break;
+		}
+
+		// The text gets copied into the history, after which the packet can go
+		// The oldest message gets overwritten once the history is full
+		ConsoleMessage& next = messagesBySource[earliest][mergePositions[earliest]++];
+		messages.Push( next );
+		next.ReleaseText();
 	}
 
-	timeToUpdate -= deltaTime;
-	if ( timeToUpdate <= 0.0f )
+	for ( std::vector<ConsoleMessage>& sourceMessages : messagesBySource )
+	{
+		sourceMessages.clear();
+	}
+
+	jumpToBottom = true;
+	return numReceived;
+}
+
+// ============================
+// ConsoleView::AddMessage
+// ============================
+void ConsoleView::AddMessage( const ConsoleMessage& message )
+{
+	messages.Push( message );
+	jumpToBottom = true;
+}
+
+// ============================
+// ConsoleView::Run
+// ============================
+void ConsoleView::Run()
+{
+	std::unique_lock<std::mutex> lock( redrawMutex );
+	uint64_t lastFrameTime = 0U;
+	while ( !stopListening )
 	{
+		// Sleeps for as long as nothing changes, the stats strip needs a refresh now and then to show the rates
+		// Showing or hiding the strip ends the wait too, so the right kind of wait starts over
+		const bool isShowingStatistics = showStatistics;
+		const auto isWoken = [this, isShowingStatistics]
+			{
+				return isRedrawRequested || stopListening || showStatistics != isShowingStatistics;
+			};
+
+		if ( isShowingStatistics )
+		{
+			redrawCondition.wait_for( lock, std::chrono::microseconds( StatsStrip::SampleIntervalMicroseconds ), isWoken );
+		}
+		else
+		{
+			redrawCondition.wait( lock, isWoken );
+		}
+
+		// Whatever gets requested until the frame interval is over ends up in the same frame
+		// The interval grows while frames take longer than the budget, input is still drawn right away by the loop
+		const uint64_t sinceLastFrame = NowMicroseconds() - lastFrameTime;
+		const uint64_t frameInterval = framePacer.GetFrameInterval();
+		if ( isRedrawRequested )
+		{
+			framePacer.OnFrameScheduled( sinceLastFrame );
+		}
+
+		if ( sinceLastFrame < frameInterval )
+		{
+			redrawCondition.wait_for( lock, std::chrono::microseconds( frameInterval - sinceLastFrame ),
+				[this]
+				{
+					return bool( stopListening );
+				} );
+		}
+
+		if ( stopListening )
+		{
+			break;
+		}
+
+		isRedrawRequested = false;
+		lastFrameTime = NowMicroseconds();
 		screen.PostEvent( Event::Custom );
-		// Update animation and autocomplete at 5 Hz
-		timeToUpdate = 0.2f;
 	}
+}
 
-	return true;
+// ============================
+// ConsoleView::RequestRedraw
+// ============================
+void ConsoleView::RequestRedraw()
+{
+	// Only the first request of a frame has to wake Run up
+	if ( isRedrawRequested.exchange( true ) )
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( redrawMutex );
+	}
+	redrawCondition.notify_one();
+}
+
+// ============================
+// ConsoleView::OnAutocompleteCatalogue
+// ============================
+void ConsoleView::OnAutocompleteCatalogue( AutocompleteRecords&& records, uint8_t source, bool isFullCatalogue )
+{
+	screen.Post( [this, records = std::move( records ), source, isFullCatalogue]() mutable
+		{
+			if ( isFullCatalogue )
+			{
+				autocompleteCatalogue.Assign( source, std::move( records ) );
+			}
+			else
+			{
+				autocompleteCatalogue.Merge( source, std::move( records ) );
+			}
+
+			UpdateAutocomplete();
+			RequestRedraw();
+		} );
+}
+
+// ============================
+// ConsoleView::SetHistoryCapacity
+// ============================
+void ConsoleView::SetHistoryCapacity( size_t capacity )
+{
+	messages.SetCapacity( capacity );
+}
+
+// ============================
+// ConsoleView::SetNumEngines
+// ============================
+void ConsoleView::SetNumEngines( size_t numEngines )
+{
+	showSources = numEngines > 1U;
 }
 
 // ============================
-// ConsoleView::SetAutocompleteBuffer
+// ConsoleView::SetStatisticsSource
 // ============================
-void ConsoleView::SetAutocompleteBuffer( const std::vector<std::string>& buffer )
+void ConsoleView::SetStatisticsSource( std::function<GetNetworkStatisticsFn> getStatistics )
 {
-	autocompleteBuffer = buffer;
+	getNetworkStatistics = getStatistics;
+}
+
+// ============================
+// ConsoleView::SetShowStatistics
+// ============================
+void ConsoleView::SetShowStatistics( bool show )
+{
+	showStatistics = show;
+}
+
+// ============================
+// ConsoleView::SetFrameBudget
+// ============================
+void ConsoleView::SetFrameBudget( float milliseconds )
+{
+	framePacer.SetBudget( uint64_t( std::max( milliseconds, 0.0f ) * 1000.0f ) );
+}
+
+// ============================
+// ConsoleView::GetFrameStatistics
+// ============================
+FramePacer::Statistics ConsoleView::GetFrameStatistics() const
+{
+	return framePacer.GetStatistics();
+}
+
+// ============================
+// ConsoleView::GetIncomingQueueDepth
+// ============================
+size_t ConsoleView::GetIncomingQueueDepth() const
+{
+	return incomingMessages.Size();
+}
+
+// ============================
+// ConsoleView::GetNumDroppedMessages
+// ============================
+size_t ConsoleView::GetNumDroppedMessages() const
+{
+	return numDroppedMessages;
+}
+
+// ============================
+// ConsoleView::GetStatisticsSample
+// ============================
+StatsStrip::Sample ConsoleView::GetStatisticsSample() const
+{
+	StatsStrip::Sample sample{};
+	if ( nullptr != getNetworkStatistics )
+	{
+		sample.network = getNetworkStatistics();
+	}
+
+	sample.frames = framePacer.GetStatistics();
+	sample.queueDepth = incomingMessages.Size();
+	sample.droppedMessages = numDroppedMessages;
+	sample.historySize = messages.Size();
+	sample.historyCapacity = messages.Capacity();
+	sample.historyBytes = messages.GetMemoryUsage() + search.GetMemoryUsage();
+	return sample;
+}
+
+// ============================
+// ConsoleView::ToggleStatistics
+// ============================
+void ConsoleView::ToggleStatistics()
+{
+	showStatistics = !showStatistics;
+	statsStrip.Reset();
+	// Shown right away, and from then on refreshed even while no messages come in
+	RequestRedraw();
 }
 
 // ============================
@@ -221,11 +514,43 @@ bool ConsoleView::ContainerEventHandler( Event e )
 		return true;
 	}
 
+	if ( e == Event::F2 )
+	{
+		ToggleStatistics();
+		return true;
+	}
+
+	// Doesn't have a name in FTXUI
+	static const Event ShiftF3 = Event::Special( "\x1B[1;2R" );
+	if ( e == Event::F3 || e == ShiftF3 || (e == Event::Return && IsSearchInput()) )
+	{
+		if ( e == ShiftF3 )
+		{
+			search.SelectNewer();
+		}
+		else
+		{
+			search.SelectOlder();
+		}
+
+		ScrollToSelectedMatch();
+		return true;
+	}
+
+	if ( e == Event::Escape && IsSearchInput() )
+	{
+		userInput.clear();
+		UpdateSearch();
+		UpdateAutocomplete();
+		return true;
+	}
+
 	if ( e == Event::Return )
 	{
 		if ( !userInput.empty() )
 		{
-			executeCommand = true;
+			ConsumeCommand();
+			UpdateAutocomplete();
 			jumpToBottom = true;
 		}
 		return true;
@@ -234,21 +559,16 @@ bool ConsoleView::ContainerEventHandler( Event e )
 		e == Event::ArrowLeft || e == Event::ArrowRight )
 	{
 		inputFieldComponent->OnEvent( e );
+		// Suggestions come from the local catalogue, and matches from the search index,
+		// so they can follow every keystroke
+		UpdateSearch();
+		UpdateAutocomplete();
 		return true;
 	}
 
-	// It's time to update
+	// Posted by Run, the frame that follows picks up whatever changed
 	if ( e == Event::Custom )
 	{
-		UpdateAutocomplete();
-		animationFrame++;
-
-		if ( jumpToBottom )
-		{
-			screen.PostEvent( Event::End );
-			jumpToBottom = false;
-		}
-
 		return true;
 	}
 
@@ -263,20 +583,30 @@ void ConsoleView::ConsumeCommand()
 	if ( userInput == "!quit" )
 	{
 		stopListening = true;
+		RequestRedraw();
 		return;
 	}
 
-	if ( !IsInputValid() )
+	if ( userInput == "!stats" )
+	{
+		ToggleStatistics();
+		userInput.clear();
+		return;
+	}
+
+	size_t target;
+	const std::string_view command = SplitTarget( userInput, target );
+	if ( !IsInputValid() || command.empty() )
 	{
 		if ( !userInput.empty() )
 		{
-			OnLog( { std::string( "$yInvalid command: '" ).append( userInput ).append( "'" ) } );
+			AddMessage( { std::string( "$yInvalid command: '" ).append( userInput ).append( "'" ) } );
 			userInput.clear();
 		}
 		return;
 	}
 
-	onCommandSubmit( userInput );
+	onCommandSubmit( command, target );
 	userInput.clear();
 }
 
@@ -285,15 +615,34 @@ void ConsoleView::ConsumeCommand()
 // ============================
 void ConsoleView::UpdateAutocomplete()
 {
-	if ( !IsInputValid() )
+	// Typing arguments, or moving the cursor, doesn't change the suggestions
+	std::string commandName = IsSearchInput() ? std::string() : GetCommandName();
+	if ( commandName == autocompleteInput && autocompleteCatalogue.GetRevision() == autocompleteRevision )
+	{
+		return;
+	}
+
+	const bool commandNameChanged = commandName != autocompleteInput;
+	autocompleteInput = std::move( commandName );
+	autocompleteRevision = autocompleteCatalogue.GetRevision();
+	if ( autocompleteInput.empty() )
 	{
 		autocompleteElement = text( "" );
 		return;
 	}
 
-	onAutocompleteRequest( userInput );
+	// Cvar values may have changed since the catalogue arrived
+	// This is debounced on the other end, so it's fine to call on every keystroke
+	if ( commandNameChanged )
+	{
+		onAutocompleteRequest( autocompleteInput );
+	}
+
+	// Don't flood the window when only a letter or two has been typed
+	constexpr size_t MaxSuggestions = 32U;
 
-	if ( autocompleteBuffer.empty() )
+	const auto [first, last] = autocompleteCatalogue.FindPrefix( autocompleteInput );
+	if ( first == last )
 	{
 		autocompleteElement = window( 
 			text( "Autocomplete" ), 
@@ -310,30 +659,24 @@ void ConsoleView::UpdateAutocomplete()
 	Elements variables{};
 	Elements commands{};
 
-	// In the autocomplete buffer, we have strings of this format:
-	// cvar_name#flags&value
-	// e.g. my_cvar#ri&100
-	for ( const std::string& cvar : autocompleteBuffer )
+	const AutocompleteRecords& records = autocompleteCatalogue.GetRecords();
+	for ( size_t i = first; i < last && i < first + MaxSuggestions; i++ )
 	{
-		size_t flagPosition = cvar.find( '#' );
-		size_t valuePosition = cvar.find( '&' );
-
-		if ( flagPosition == std::string::npos
-			|| valuePosition == std::string::npos
-			|| flagPosition >= valuePosition )
+		// Engines that know the same name are next to each other, show it once
+		const std::string& name = records.names[i];
+		if ( i > first && name == records.names[i - 1U] )
 		{
 			continue;
 		}
 
-		std::string name = cvar.substr( 0, flagPosition );
-		std::string value = cvar.substr( valuePosition );
-
-		if ( cvar.find( 'c', flagPosition ) )
+		if ( records.kinds[i] == AutocompleteKind::Command )
 		{
 			commands.emplace_back( text( name ) );
 			continue;
 		}
 
+		std::string value = records.values[i];
+
 		constexpr int ValueWidth = 6;
 
 		if ( value.size() > ValueWidth )
@@ -344,9 +687,9 @@ void ConsoleView::UpdateAutocomplete()
 			value[ValueWidth-3] = '.';
 		}
 
-		const bool readOnly = cvar.find( 'r', flagPosition );
+		const bool readOnly = records.flags[i] & AutocompleteRecords::FlagReadOnly;
 		Element vtext = hbox( {
-				text( std::string( name ) ),
+				text( name ),
 				text( readOnly ? " (read-only)" : "" ),
 				filler() | xflex_shrink,
 				text( ": " + value ) | size( WIDTH, EQUAL, ValueWidth + 2 ),
@@ -381,94 +724,64 @@ void ConsoleView::UpdateAutocomplete()
 }
 
 // ============================
-// ConsoleView::ConsoleMessageToFtxElement
+// ConsoleView::IsSearchInput
 // ============================
-Element ConsoleView::ConsoleMessageToFtxElement( const ConsoleMessage& message )
+bool ConsoleView::IsSearchInput() const
 {
-	static std::unordered_map<char, Color> ColourMap
-	{
-		{ 'r', Color::Red },
-		{ 'o', Color::Orange1 },
-		{ 'y', Color::Yellow },
-		{ 'g', Color::GreenLight },
-		{ 'b', Color::BlueLight },
-		{ 'p', Color::Pink1 },
-		{ 'w', Color::White },
-		{ 'G', Color::GrayLight }
-	};
-
-	char currentColour = 'w';
-	Elements colouredTexts{};
-	ElementDecorator textColour = color( ColourMap[currentColour] );
-	std::string string;
-	for ( size_t i = 0; i < message.text.size(); i++ )
-	{
-		if ( message.text[i] == '$' )
-		{
-			if ( !string.empty() )
-			{
-				colouredTexts.emplace_back( text( string ) | textColour );
-				string.clear();
-			}
-
-			i++;
-			if ( i >= message.text.size() )
-			{
-				break;
-			}
-
-			currentColour = message.text[i];
-
-			auto iterator = ColourMap.find( currentColour );
-			if ( iterator == ColourMap.end() )
-			{
-				textColour = color( Color::White );
-			}
-			else
-			{
-				textColour = color( iterator->second );
-			}
-
-			i++;
-			if ( i >= message.text.size() )
-			{
-				break;
-			}
-		}
-
-		string += message.text[i];
+	return !userInput.empty() && userInput[0] == '/';
+}
 
-		if ( i == message.text.size() - 1 )
-		{
-			colouredTexts.emplace_back( text( string ) | textColour );
-		}
+// ============================
+// ConsoleView::UpdateSearch
+// ============================
+void ConsoleView::UpdateSearch()
+{
+	const std::string_view query = IsSearchInput() ? std::string_view( userInput ).substr( 1U ) : std::string_view();
+	if ( query == search.GetQuery() )
+	{
+		return;
 	}
 
-	return hbox(
-		{
-			text( GenerateTimeString( message ) ),
-			separator(),
-			text( " " ),
-			hbox( std::move( colouredTexts ) )
-		} );
+	const bool wasActive = search.IsActive();
+	search.SetQuery( query );
+	if ( search.IsActive() )
+	{
+		ScrollToSelectedMatch();
+	}
+	else if ( wasActive )
+	{
+		// Back to following the output
+		jumpToBottom = true;
+	}
 }
 
 // ============================
-// ConsoleView::GenerateTimeString
+// ConsoleView::ScrollToSelectedMatch
 // ============================
-const char* ConsoleView::GenerateTimeString( const ConsoleMessage& message )
+void ConsoleView::ScrollToSelectedMatch()
 {
-	// mmm:ss.ssss 
-	static char buffer[16];
+	if ( search.GetNumMatches() > 0U )
+	{
+		messageScrollerComponent->Select( search.GetSelectedMatch() );
+	}
+}
 
-	const int iTime = message.timeSubmitted;
-	const int seconds = int( message.timeSubmitted ) % 60;
-	const int minutes = iTime / 60;
+// ============================
+// ConsoleView::RenderSearchStatus
+// ============================
+Element ConsoleView::RenderSearchStatus() const
+{
+	if ( !search.IsActive() )
+	{
+		return text( "" );
+	}
 
-	const float flSeconds = seconds + (message.timeSubmitted - iTime);
+	if ( search.GetNumMatches() == 0U )
+	{
+		return text( " no matches " ) | color( Color::Yellow );
+	}
 
-	sprintf( buffer, "%03i:%06.3f ", minutes, flSeconds );
-	return buffer;
+	return text( " " + std::to_string( search.GetSelectedPosition() ) + "/" + std::to_string( search.GetNumMatches() ) + " " );
 }
 
 // ============================
@@ -499,12 +812,52 @@ std::string ConsoleView::GetCommandName() const
 		return "";
 	}
 
+	size_t target;
+	const std::string_view command = SplitTarget( userInput, target );
+
 	// Simple, one-word command
-	const size_t firstSpace = userInput.find_first_of( " " );
+	const size_t firstSpace = command.find_first_of( " " );
 	if ( firstSpace == std::string::npos )
 	{
-		return userInput;
+		return std::string( command );
+	}
+
+	return std::string( command.substr( 0, firstSpace ) );
+}
+
+// ============================
+// ConsoleView::SplitTarget
+// 
+// "@2 map test" gives target 2 and "map test",
+// anything that doesn't start with '@' and a number goes to all engines as it is
+// ============================
+std::string_view ConsoleView::SplitTarget( std::string_view input, size_t& outTarget )
+{
+	outTarget = 0U;
+	if ( input.empty() || input[0] != '@' )
+	{
+		return input;
+	}
+
+	size_t target = 0U;
+	size_t position = 1U;
+	while ( position < input.size() && input[position] >= '0' && input[position] <= '9' )
+	{
+		// Anything this big is an invalid target anyway, just don't let it overflow
+		target = std::min<size_t>( target * 10U + (input[position] - '0'), 1'000'000U );
+		position++;
+	}
+
+	if ( position == 1U )
+	{
+		return input;
+	}
+
+	while ( position < input.size() && input[position] == ' ' )
+	{
+		position++;
 	}
 
-	return userInput.substr( 0, firstSpace );
+	outTarget = target;
+	return input.substr( position );
 }
@@ -1,11 +1,18 @@
 // SPDX-FileCopyrightText: 2023 Admer Šuko
 // SPDX-License-Identifier: MIT
 
+#include <condition_variable>
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/component_base.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
 #include "ftxui/Scroller.hpp"
+#include "Model/AutocompleteCatalogue.hpp"
+#include "Model/MessageHistory.hpp"
+#include "Model/MessageSearch.hpp"
+#include "Model/SpscQueue.hpp"
+#include "FramePacer.hpp"
+#include "StatsStrip.hpp"
 
 using namespace ftxui;
 
@@ -16,65 +23,150 @@ class ConsoleView final
 {
 public:
 	// Called whenever a command is successfully submitted
-	using OnCommandSubmitFn = void( std::string_view command );
-	using OnAutocompleteRequestFn = void( std::string_view command );
+	// Target is the engine number from an "@N" prefix, or 0 if it's meant for all of them
+	using OnCommandSubmitFn = void( std::string_view command, size_t target );
+	// Called when the user starts typing a different command name
+	using OnAutocompleteRequestFn = void( std::string_view prefix );
+	// Polled every frame while the stats strip is shown
+	using GetNetworkStatisticsFn = Network::Statistics();
 public:
 	void Init( std::function<OnCommandSubmitFn> commandSubmit,
 		std::function<OnAutocompleteRequestFn> autocompleteRequest );
 	void Shutdown();
 
-	void OnLog( const ConsoleMessage& message );
-	bool OnUpdate( const float& deltaTime );
+	// Builds the UI without taking over the terminal, frames are then drawn with RenderOffscreen
+	// Init does this and then runs the terminal loop, the benchmarks use it directly
+	void InitOffscreen( std::function<OnCommandSubmitFn> commandSubmit,
+		std::function<OnAutocompleteRequestFn> autocompleteRequest );
+	// Draws one frame of the whole UI into target, the same way the terminal loop would
+	void RenderOffscreen( Screen& target );
+
+	// Queues messages to be shown on the next frame, never blocks
+	// Only one thread may be logging at a time, normally the network thread
+	// Moves the messages out, along with any packets and text they own
+	void OnLog( ConsoleMessage&& message );
+	void OnLog( ConsoleMessage* logMessages, size_t numMessages );
+	// Schedules redraws until the user quits, blocks the calling thread in the meantime
+	// Nothing is drawn unless something changed, and at most one frame per FramePacer::GetFrameInterval
+	void Run();
+	// Something changed that needs a new frame, can be called from any thread
+	void RequestRedraw();
+
+	// Hands the catalogue over to the UI thread, can be called from any thread
+	void OnAutocompleteCatalogue( AutocompleteRecords&& records, uint8_t source, bool isFullCatalogue );
+	// Number of messages kept in the scrollback, older ones are discarded
+	// Must be called before Init
+	void SetHistoryCapacity( size_t capacity );
+	// With more than one engine, every line is tagged with the engine it came from
+	// Must be called before Init
+	void SetNumEngines( size_t numEngines );
+	// Where the stats strip gets its network figures from
+	// Must be called before Init
+	void SetStatisticsSource( std::function<GetNetworkStatisticsFn> getStatistics );
+	// Whether the stats strip starts out shown, F2 or '!stats' toggles it
+	// Must be called before Init
+	void SetShowStatistics( bool show );
+	// How long drawing a frame may take before frames are spaced further apart, see FramePacer
+	void SetFrameBudget( float milliseconds );
+	FramePacer::Statistics GetFrameStatistics() const;
 
-	void SetAutocompleteBuffer( const std::vector<std::string>& buffer );
+	// Messages logged but not yet picked up by the UI thread
+	size_t GetIncomingQueueDepth() const;
+	// Messages thrown away because the UI thread couldn't keep up
+	size_t GetNumDroppedMessages() const;
 
 private:
 	// Handles CLI events i.e. input and scrolling
 	bool ContainerEventHandler( Event e );
+	// Moves queued messages into the history, called on the UI thread at the start of each frame
+	// Messages from different engines are merged by time
+	// Returns how many there were
+	size_t DrainIncomingMessages();
+	// Copies a message straight into the history, UI thread only
+	void AddMessage( const ConsoleMessage& message );
 	void ConsumeCommand();
+	// Rebuilds the autocomplete window from the local catalogue
+	// When the command name changes, fresh values are also requested, they're merged in once they arrive
 	void UpdateAutocomplete();
+	// Input starting with '/' searches the history as it's typed, Enter and F3 go to the next
+	// older match, Shift+F3 to the next newer one, Escape ends the search
+	bool IsSearchInput() const;
+	void UpdateSearch();
+	void ScrollToSelectedMatch();
+	// "3/120" on the right of the input bar
+	Element RenderSearchStatus() const;
+
+	// Gathered right before a frame, while the stats strip is shown
+	StatsStrip::Sample GetStatisticsSample() const;
+	void ToggleStatistics();
 
 	bool IsInputValid() const;
 	std::string GetCommandName() const;
-
-	static const char* GenerateTimeString( const ConsoleMessage& message );
-	static Element ConsoleMessageToFtxElement( const ConsoleMessage& message );
+	// Strips the "@N " routing prefix off the input
+	static std::string_view SplitTarget( std::string_view input, size_t& outTarget );
 
 private:
 	std::function<OnCommandSubmitFn> onCommandSubmit{ nullptr };
 	std::function<OnAutocompleteRequestFn> onAutocompleteRequest{ nullptr };
+	std::function<GetNetworkStatisticsFn> getNetworkStatistics{ nullptr };
+
+	static constexpr size_t IncomingQueueCapacity = 8192U;
 
-	bool stopListening{ false };
-	std::vector<ConsoleMessage> messages{};
-	std::vector<std::string> autocompleteBuffer{};
+	std::atomic<bool> stopListening{ false };
+	// Only touched by the UI thread
+	MessageHistory messages{};
+	// Indexes everything that goes into messages
+	MessageSearch search{ messages };
+	bool showSources{ false };
+	// Reused by DrainIncomingMessages, indexed by ConsoleMessage::source
+	std::vector<std::vector<ConsoleMessage>> messagesBySource{};
+	std::vector<size_t> mergePositions{};
+	// Network thread -> UI thread
+	SpscQueue<ConsoleMessage> incomingMessages{ IncomingQueueCapacity };
+	std::atomic<size_t> numDroppedMessages{ 0U };
+	// Frames are coalesced to what a terminal can usefully show, and spaced out when they're slow
+	FramePacer framePacer{};
+	// Guards nothing but the wake-ups of Run
+	std::mutex redrawMutex;
+	std::condition_variable redrawCondition;
+	std::atomic<bool> isRedrawRequested{ false };
+	// Only touched by the UI thread
+	AutocompleteCatalogue autocompleteCatalogue{};
+	// Only touched by the UI thread, does nothing while hidden
+	StatsStrip statsStrip{};
+	// Also read by Run, to keep the rates fresh
+	std::atomic<bool> showStatistics{ false };
 
 	std::thread listenerThread;
-	float timeToUpdate{ 0.1f };
-	// If true, the network thread will have to wait for rendering to be finished
-	bool isRenderingMessages{ false };
-	// The user has entered a new command, jump to bottom to see the output
+	// Init waits on this, the loop is running once the first frame gets built
+	std::promise<void> firstFrameDrawn{};
+	bool hasDrawnFrame{ false };
+	static constexpr std::chrono::milliseconds FirstFrameTimeout{ 1000 };
+	// New messages came in or the user entered a command, jump to bottom to see the output
+	// Held off while searching, so the selected match stays in view
 	bool jumpToBottom{ false };
-	// The user has entered a new command, execute it on the main thread
-	bool executeCommand{ false };
 
 	// User input string
 	std::string userInput{ "" };
 	// Element that contains the autocomplete window
-	// Is updated periodically instead of every frame
+	// Is updated when the input or the catalogue changes instead of every frame
 	Element autocompleteElement = text( "" );
+	// Command name and catalogue revision the autocomplete window was last built for
+	std::string autocompleteInput{};
+	uint32_t autocompleteRevision{ 0U };
 
 	// The screen object where everything happens
 	ScreenInteractive screen = ScreenInteractive::Fullscreen();
+	// Set by Init, offscreen frames are drawn by RenderOffscreen instead of the screen's loop
+	bool isInteractive{ false };
 	// Frame of the little animation in the top-right corner
 	int animationFrame{ 0 };
 	// Title bar on the top
 	Component consoleTitleComponent{};
 	// Text input bar on the bottom
 	Component inputFieldComponent{};
-	// Displays the actual ConsoleMessages
-	Component messageFrameComponent{};
-	// Parent of messageFrameComponent
-	Component messageScrollerComponent{};
+	// Displays the actual ConsoleMessages, only builds the visible ones
+	std::shared_ptr<ScrollerBase> messageScrollerComponent{};
 	// Logical container for inputFieldComponent and messageScrollerComponent
 	Component containerComponent{};
 	// Parent of all the above
@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+
+#include "FramePacer.hpp"
+#include <ftxui/dom/node.hpp>
+#include <ftxui/component/screen_interactive.hpp>
+
+using namespace ftxui;
+
+namespace
+{
+	// Ends the frame's timing once its only child has been drawn
+	class FrameTimerNode final : public Node
+	{
+	public:
+		FrameTimerNode( Element frame, FramePacer& framePacer, size_t numFrameMessages, ScreenInteractive* frameScreen )
+			: Node( { std::move( frame ) } ), pacer( framePacer ), numMessages( numFrameMessages ), screen( frameScreen )
+		{
+		}
+
+		void ComputeRequirement() override
+		{
+			children_[0]->ComputeRequirement();
+			requirement_ = children_[0]->requirement();
+		}
+
+		void SetBox( Box box ) override
+		{
+			Node::SetBox( box );
+			children_[0]->SetBox( box );
+		}
+
+		void Render( Screen& target ) override
+		{
+			children_[0]->Render( target );
+			if ( nullptr == screen )
+			{
+				pacer.EndFrame( numMessages );
+				return;
+			}
+
+			// The screen turns the frame into text and writes it out right after this,
+			// and only then gets around to the tasks posted to it
+			screen->Post( [&pacer = pacer, numMessages = numMessages]
+				{
+					pacer.EndFrame( numMessages );
+				} );
+		}
+
+	private:
+		FramePacer& pacer;
+		size_t numMessages;
+		ScreenInteractive* screen;
+	};
+}
+
+// ============================
+// FramePacer::SetBudget
+// ============================
+void FramePacer::SetBudget( uint64_t microseconds )
+{
+	budget = std::max<uint64_t>( microseconds, 1U );
+}
+
+// ============================
+// FramePacer::BeginFrame
+// ============================
+void FramePacer::BeginFrame()
+{
+	frameStartTime = NowMicroseconds();
+}
+
+// ============================
+// FramePacer::TimeFrame
+// ============================
+Element FramePacer::TimeFrame( Element frame, size_t numMessages, ScreenInteractive* screen )
+{
+	return std::make_shared<FrameTimerNode>( std::move( frame ), *this, numMessages, screen );
+}
+
+// ============================
+// FramePacer::EndFrame
+// ============================
+void FramePacer::EndFrame( size_t numMessages )
+{
+	const uint64_t drawMicroseconds = NowMicroseconds() - frameStartTime;
+	// Only the UI thread draws, so none of these need an atomic add
+	const uint64_t previousAverage = averageDrawTime.load( std::memory_order_relaxed );
+	averageDrawTime.store( previousAverage == 0U ? drawMicroseconds : (previousAverage * 3U + drawMicroseconds) / 4U,
+		std::memory_order_relaxed );
+
+	numFrames.store( numFrames.load( std::memory_order_relaxed ) + 1U, std::memory_order_relaxed );
+	totalDrawTime.store( totalDrawTime.load( std::memory_order_relaxed ) + drawMicroseconds, std::memory_order_relaxed );
+	totalFrameMessages.store( totalFrameMessages.load( std::memory_order_relaxed ) + numMessages, std::memory_order_relaxed );
+	if ( numMessages > maxFrameMessages.load( std::memory_order_relaxed ) )
+	{
+		maxFrameMessages.store( uint32_t( std::min<size_t>( numMessages, UINT32_MAX ) ), std::memory_order_relaxed );
+	}
+}
+
+// ============================
+// FramePacer::GetFrameInterval
+// ============================
+uint64_t FramePacer::GetFrameInterval() const
+{
+	const uint64_t drawTime = averageDrawTime.load( std::memory_order_relaxed );
+	const uint64_t frameBudget = budget.load( std::memory_order_relaxed );
+	if ( drawTime <= frameBudget )
+	{
+		return MinFrameIntervalMicroseconds;
+	}
+
+	return MinFrameIntervalMicroseconds * drawTime / frameBudget;
+}
+
+// ============================
+// FramePacer::OnFrameScheduled
+// ============================
+void FramePacer::OnFrameScheduled( uint64_t sinceLastFrame )
+{
+	// Without pacing, the frame would go out once the minimum interval is over, or right away if it already is
+	const uint64_t interval = GetFrameInterval();
+	const uint64_t unpacedTime = std::max( sinceLastFrame, MinFrameIntervalMicroseconds );
+	if ( interval > unpacedTime )
+	{
+		numDroppedFrames += (interval - unpacedTime + MinFrameIntervalMicroseconds - 1U) / MinFrameIntervalMicroseconds;
+	}
+}
+
+// ============================
+// FramePacer::GetStatistics
+// ============================
+FramePacer::Statistics FramePacer::GetStatistics() const
+{
+	Statistics statistics{};
+	statistics.numFrames = numFrames.load( std::memory_order_relaxed );
+	statistics.numDroppedFrames = numDroppedFrames.load( std::memory_order_relaxed );
+	statistics.totalDrawMicroseconds = totalDrawTime.load( std::memory_order_relaxed );
+	statistics.totalFrameMessages = totalFrameMessages.load( std::memory_order_relaxed );
+	statistics.maxFrameMessages = maxFrameMessages.load( std::memory_order_relaxed );
+	return statistics;
+}
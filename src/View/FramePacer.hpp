@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <ftxui/dom/elements.hpp>
+
+namespace ftxui
+{
+	class ScreenInteractive;
+}
+
+// ============================
+// FramePacer
+//
+// Decides how far apart frames have to be. Normally that's MinFrameInterval, so a flood
+// of messages turns into one redraw per interval rather than one per message.
+// When drawing takes longer than the frame budget, the interval stretches in proportion,
+// so the UI thread never spends more than budget / MinFrameInterval of its time drawing
+// and keeps up with input. The frames skipped that way are counted as dropped.
+//
+// A frame is timed from when it starts taking in messages until the terminal has been sent it
+// ============================
+class FramePacer final
+{
+public:
+	// Running totals, sample them over time to get rates and averages
+	struct Statistics
+	{
+		uint64_t numFrames;
+		// Frames left out to stay within the budget
+		uint64_t numDroppedFrames;
+		uint64_t totalDrawMicroseconds;
+		// Messages that went into the history while frames were being prepared
+		uint64_t totalFrameMessages;
+		uint32_t maxFrameMessages;
+	};
+
+	static constexpr uint64_t MinFrameIntervalMicroseconds = 1'000'000U / 60U;
+	static constexpr uint64_t DefaultBudgetMicroseconds = 8'000U;
+
+public:
+	// Can be called from any thread
+	void SetBudget( uint64_t microseconds );
+
+	// Starts timing a frame, before its messages are taken in
+	void BeginFrame();
+	// Wraps the frame, which brought numMessages new messages with it, so it stops being timed
+	// once the screen has written it out, or once it's drawn if there is no screen
+	ftxui::Element TimeFrame( ftxui::Element frame, size_t numMessages, ftxui::ScreenInteractive* screen );
+	// Called through the node TimeFrame wraps the frame in
+	void EndFrame( size_t numMessages );
+
+	// How long after the start of the last frame the next one may start, can be called from any thread
+	uint64_t GetFrameInterval() const;
+	// Counts the frames that were due within the last interval but didn't happen
+	void OnFrameScheduled( uint64_t sinceLastFrame );
+
+	Statistics GetStatistics() const;
+
+private:
+	std::atomic<uint64_t> budget{ DefaultBudgetMicroseconds };
+	// Smoothed, so a single slow frame doesn't stall the next few
+	std::atomic<uint64_t> averageDrawTime{ 0U };
+	// Only touched by the UI thread
+	uint64_t frameStartTime{ 0U };
+
+	std::atomic<uint64_t> numFrames{ 0U };
+	std::atomic<uint64_t> numDroppedFrames{ 0U };
+	std::atomic<uint64_t> totalDrawTime{ 0U };
+	std::atomic<uint64_t> totalFrameMessages{ 0U };
+	std::atomic<uint32_t> maxFrameMessages{ 0U };
+};
@@ -0,0 +1,297 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+
+#include "MessageLinesNode.hpp"
+#include "Model/MessageHistory.hpp"
+#include "Model/MessageSearch.hpp"
+#include <ftxui/screen/string.hpp>
+
+using namespace ftxui;
+
+namespace
+{
+	// Indexed by ConsoleColour::Enum
+	const Color Palette[ConsoleColour::Count]
+	{
+		Color::White,
+		Color::Red,
+		Color::Orange1,
+		Color::Yellow,
+		Color::GreenLight,
+		Color::BlueLight,
+		Color::Pink1,
+		Color::GrayLight
+	};
+
+	// Engine tags cycle through these, so neighbouring engines are easy to tell apart
+	const Color SourcePalette[]
+	{
+		Color::Cyan,
+		Color::Magenta,
+		Color::GreenLight,
+		Color::Yellow,
+		Color::BlueLight,
+		Color::Red
+	};
+
+	// The "×N last mmm:ss.sss" after a repeated message
+	const Color RepeatColour = Color::GrayDark;
+
+	// What separator() draws inside an hbox
+	constexpr std::string_view Separator = "│";
+
+	// Number of bytes in the UTF-8 sequence starting with this byte
+	size_t Utf8SequenceLength( uint8_t leadByte )
+	{
+		if ( leadByte < 0xC0 )
+		{
+			// ASCII, or a stray continuation byte that gets drawn on its own
+			return 1U;
+		}
+
+		if ( leadByte < 0xE0 )
+		{
+			return 2U;
+		}
+
+		return leadByte < 0xF0 ? 3U : 4U;
+	}
+
+	// Tabs and the like would mess up the terminal, C1 controls included
+	bool IsControlCharacter( std::string_view glyph )
+	{
+		return uint8_t( glyph[0] ) < ' ' || (uint8_t( glyph[0] ) == 0xC2 && glyph.size() > 1U && uint8_t( glyph[1] ) < 0xA0);
+	}
+
+	// Columns a glyph takes up, measured the way FTXUI's own text is:
+	// 2 for wide ones like CJK and most emoji, 0 for combining marks
+	int GlyphWidth( std::string_view glyph )
+	{
+		// Nearly everything engines print is ASCII, which doesn't need a lookup
+		if ( uint8_t( glyph[0] ) < 0x80 || IsControlCharacter( glyph ) )
+		{
+			return 1;
+		}
+
+		// Short enough for the small string optimisation, so this doesn't allocate
+		return std::clamp( string_width( std::string( glyph ) ), 0, 2 );
+	}
+
+	// Number of columns DrawText takes up for this text
+	int CountColumns( std::string_view text )
+	{
+		int columns = 0;
+		for ( size_t i = 0U; i < text.size(); )
+		{
+			const size_t length = std::min( Utf8SequenceLength( uint8_t( text[i] ) ), text.size() - i );
+			columns += GlyphWidth( text.substr( i, length ) );
+			i += length;
+		}
+
+		return columns;
+	}
+}
+
+// ============================
+// MessageLinesNode::ctor
+// ============================
+MessageLinesNode::MessageLinesNode( const MessageHistory& messageHistory, size_t firstMessage, size_t lastMessage, bool showMessageSources,
+	const MessageSearch* messageSearch )
+	: history( messageHistory ), first( firstMessage ), last( lastMessage ), showSources( showMessageSources ),
+	search( nullptr != messageSearch && messageSearch->IsActive() ? messageSearch : nullptr )
+{
+}
+
+// ============================
+// MessageLinesNode::ComputeRequirement
+// ============================
+void MessageLinesNode::ComputeRequirement()
+{
+	requirement_ = {};
+	requirement_.min_y = int( last - first );
+	requirement_.flex_grow_x = 1;
+	requirement_.flex_shrink_x = 1;
+}
+
+// ============================
+// MessageLinesNode::Render
+// ============================
+void MessageLinesNode::Render( Screen& screen )
+{
+	// When inside a frame, the box can be much taller than what's actually on screen
+	const int yMin = std::max( box_.y_min, screen.stencil.y_min );
+	const int yMax = std::min( box_.y_max, screen.stencil.y_max );
+	const int xMax = std::min( box_.x_max, screen.stencil.x_max );
+
+	for ( int y = yMin; y <= yMax; y++ )
+	{
+		const size_t messageIndex = first + size_t( y - box_.y_min );
+		if ( messageIndex >= last )
+		{
+			break;
+		}
+
+		const ConsoleMessage& message = history.At( messageIndex );
+
+		int x = box_.x_min;
+		x = DrawText( screen, x, y, xMax, GenerateTimeString( message.timeSubmitted ), nullptr );
+		x = DrawText( screen, x, y, xMax, Separator, nullptr );
+		x = DrawText( screen, x, y, xMax, " ", nullptr );
+
+		// The app's own messages aren't tagged
+		if ( showSources && message.source != 0U )
+		{
+			char tag[8];
+			const int tagLength = snprintf( tag, sizeof( tag ), "@%u ", unsigned( message.source ) );
+			const Color& tagColour = SourcePalette[(message.source - 1U) % std::size( SourcePalette )];
+			x = DrawText( screen, x, y, xMax, std::string_view( tag, tagLength ), &tagColour );
+		}
+
+		const std::string_view messageText = message.text;
+		const int textX = x;
+		for ( size_t i = 0U; i < message.numColourSpans && x <= xMax; i++ )
+		{
+			const ConsoleColourSpan& span = message.GetColourSpan( i );
+			x = DrawText( screen, x, y, xMax, messageText.substr( span.offset, span.length ), &Palette[span.colour] );
+		}
+
+		if ( nullptr != search )
+		{
+			HighlightMatches( screen, textX, y, xMax, messageText, search->GetQuery(),
+				messageIndex == search->GetSelectedMatch() );
+		}
+
+		if ( message.repeatCount > 1U && x <= xMax )
+		{
+			char repeats[64];
+			const int repeatsLength = snprintf( repeats, sizeof( repeats ), " ×%u last %s",
+				unsigned( message.repeatCount ), GenerateTimeString( message.timeLastRepeated ) );
+			x = DrawText( screen, x, y, xMax, std::string_view( repeats, repeatsLength ), &RepeatColour );
+		}
+	}
+}
+
+// ============================
+// MessageLinesNode::GenerateTimeString
+// ============================
+const char* MessageLinesNode::GenerateTimeString( uint64_t microseconds )
+{
+	// mmm:ss.sss 
+	static char buffer[32];
+
+	const uint64_t milliseconds = microseconds / 1'000U;
+	const unsigned minutes = unsigned( milliseconds / 60'000U );
+	const unsigned seconds = unsigned( milliseconds / 1'000U % 60U );
+
+	snprintf( buffer, sizeof( buffer ), "%03u:%02u.%03u ", minutes, seconds, unsigned( milliseconds % 1'000U ) );
+	return buffer;
+}
+
+// ============================
+// MessageLinesNode::DrawText
+// ============================
+int MessageLinesNode::DrawText( Screen& screen, int x, int y, int xMax, std::string_view text,
+	const Color* colour )
+{
+	size_t i = 0U;
+	while ( i < text.size() && x <= xMax )
+	{
+		const size_t length = std::min( Utf8SequenceLength( uint8_t( text[i] ) ), text.size() - i );
+		const std::string_view glyph = text.substr( i, length );
+		i += length;
+
+		const int width = GlyphWidth( glyph );
+		if ( width == 0 )
+		{
+			// Combining marks go with the glyph before them, skipping the empty half of a wide one
+			if ( x > 0 )
+			{
+				Pixel* previous = &screen.PixelAt( x - 1, y );
+				if ( previous->character.empty() && x > 1 )
+				{
+					previous = &screen.PixelAt( x - 2, y );
+				}
+				previous->character.append( glyph );
+			}
+			continue;
+		}
+
+		// Half a wide glyph can't be drawn
+		if ( x + width - 1 > xMax )
+		{
+			break;
+		}
+
+		for ( int column = 0; column < width; column++ )
+		{
+			Pixel& pixel = screen.PixelAt( x + column, y );
+			if ( column > 0 )
+			{
+				// The terminal draws a wide glyph over the next column, so it stays empty, like FTXUI does it
+				pixel.character.clear();
+			}
+			else if ( IsControlCharacter( glyph ) )
+			{
+				pixel.character = " ";
+			}
+			else
+			{
+				// Short enough for the small string optimisation, so this doesn't allocate
+				pixel.character.assign( glyph.data(), glyph.size() );
+			}
+
+			if ( nullptr != colour )
+			{
+				pixel.foreground_color = *colour;
+			}
+		}
+
+		x += width;
+	}
+
+	return x;
+}
+
+// ============================
+// MessageLinesNode::HighlightMatches
+// ============================
+void MessageLinesNode::HighlightMatches( Screen& screen, int x, int y, int xMax, std::string_view text,
+	std::string_view query, bool isSelected )
+{
+	// Matches are found by byte but drawn by column, so the columns are counted along the way
+	size_t position = 0U;
+	size_t match = MessageSearch::FindInText( text, query );
+	while ( match != std::string_view::npos && x <= xMax )
+	{
+		x += CountColumns( text.substr( position, match - position ) );
+		const int matchEnd = x + CountColumns( text.substr( match, query.size() ) );
+		for ( ; x < matchEnd && x <= xMax; x++ )
+		{
+			Pixel& pixel = screen.PixelAt( x, y );
+			if ( isSelected )
+			{
+				pixel.foreground_color = Color::Black;
+				pixel.background_color = Color::Yellow;
+			}
+			else
+			{
+				pixel.inverted = true;
+			}
+		}
+
+		x = matchEnd;
+		position = match + query.size();
+		match = MessageSearch::FindInText( text, query, position );
+	}
+}
+
+// ============================
+// MessageLines
+// ============================
+Element MessageLines( const MessageHistory& history, size_t first, size_t last, bool showSources,
+	const MessageSearch* search )
+{
+	return std::make_shared<MessageLinesNode>( history, first, last, showSources, search );
+}
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/dom/node.hpp>
+#include <ftxui/screen/screen.hpp>
+
+class MessageHistory;
+class MessageSearch;
+
+// ============================
+// MessageLinesNode
+// 
+// Draws a range of messages from the history, one per line:
+// 000:01.059 │ Message text
+// or, when several engines are connected:
+// 000:01.059 │ @2 Message text
+// and a repeated message is drawn once, with how often it came and when it last did:
+// 000:01.059 │ Message text ×120 last 000:04.310
+// While a search is going on, its matches are highlighted, the selected one stands out
+// 
+// Everything is written directly into the screen's pixels from the
+// pre-parsed message data, there are no child nodes and no allocations per line
+// ============================
+class MessageLinesNode final : public ftxui::Node
+{
+public:
+	MessageLinesNode( const MessageHistory& messageHistory, size_t firstMessage, size_t lastMessage, bool showMessageSources,
+		const MessageSearch* messageSearch );
+
+	void ComputeRequirement() override;
+	void Render( ftxui::Screen& screen ) override;
+
+	// Formats a message time as mmm:ss.sss, the returned buffer is reused by the next call
+	static const char* GenerateTimeString( uint64_t microseconds );
+
+private:
+	// Writes text starting at x, returns the column after the last written character
+	// Glyphs take up as many columns as FTXUI gives them, so wide ones line up with the rest of the UI
+	static int DrawText( ftxui::Screen& screen, int x, int y, int xMax, std::string_view text,
+		const ftxui::Color* colour );
+	// Highlights every occurrence of query in text, which was drawn starting at x
+	static void HighlightMatches( ftxui::Screen& screen, int x, int y, int xMax, std::string_view text,
+		std::string_view query, bool isSelected );
+
+private:
+	const MessageHistory& history;
+	size_t first;
+	size_t last;
+	bool showSources;
+	const MessageSearch* search;
+};
+
+// Renders messages [first, last) from the history, highlighting the matches of search if there is one
+ftxui::Element MessageLines( const MessageHistory& history, size_t first, size_t last, bool showSources = false,
+	const MessageSearch* search = nullptr );
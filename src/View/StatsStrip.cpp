@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#include "Precompiled.hpp"
+
+#include "StatsStrip.hpp"
+
+using namespace ftxui;
+
+namespace
+{
+	// 950, 12.3k, 4.5M
+	std::string FormatCount( double value )
+	{
+		char buffer[32];
+		if ( value >= 1'000'000.0 )
+		{
+			snprintf( buffer, sizeof( buffer ), "%.1fM", value / 1'000'000.0 );
+		}
+		else if ( value >= 1'000.0 )
+		{
+			snprintf( buffer, sizeof( buffer ), "%.1fk", value / 1'000.0 );
+		}
+		else
+		{
+			snprintf( buffer, sizeof( buffer ), "%.0f", value );
+		}
+
+		return buffer;
+	}
+
+	// 512 B, 845.2 KiB, 12.5 MiB
+	std::string FormatBytes( double bytes )
+	{
+		char buffer[32];
+		if ( bytes >= 1024.0 * 1024.0 )
+		{
+			snprintf( buffer, sizeof( buffer ), "%.1f MiB", bytes / (1024.0 * 1024.0) );
+		}
+		else if ( bytes >= 1024.0 )
+		{
+			snprintf( buffer, sizeof( buffer ), "%.1f KiB", bytes / 1024.0 );
+		}
+		else
+		{
+			snprintf( buffer, sizeof( buffer ), "%.0f B", bytes );
+		}
+
+		return buffer;
+	}
+}
+
+// ============================
+// StatsStrip::Update
+// ============================
+bool StatsStrip::Update( const Sample& sample, uint64_t nowMicroseconds )
+{
+	latest = sample;
+
+	// The first sample after being shown only sets the baseline
+	if ( previousTime == 0U || nowMicroseconds < previousTime )
+	{
+		previous = sample;
+		previousTime = nowMicroseconds;
+		return false;
+	}
+
+	const uint64_t elapsed = nowMicroseconds - previousTime;
+	if ( elapsed < SampleIntervalMicroseconds )
+	{
+		return false;
+	}
+
+	const double seconds = elapsed / 1'000'000.0;
+	messagesPerSecond = float( (sample.network.messagesReceived - previous.network.messagesReceived) / seconds );
+	bytesPerSecond = float( (sample.network.bytesReceived - previous.network.bytesReceived) / seconds );
+
+	const FramePacer::Statistics& frames = sample.frames;
+	const FramePacer::Statistics& previousFrames = previous.frames;
+	const uint64_t numFrames = frames.numFrames - previousFrames.numFrames;
+	framesPerSecond = float( numFrames / seconds );
+	averageFrameTime = numFrames == 0U ? 0.0f
+		: float( frames.totalDrawMicroseconds - previousFrames.totalDrawMicroseconds ) / numFrames;
+	messagesPerFrame = numFrames == 0U ? 0.0f
+		: float( frames.totalFrameMessages - previousFrames.totalFrameMessages ) / numFrames;
+	droppedFrames = frames.numDroppedFrames - previousFrames.numDroppedFrames;
+
+	previous = sample;
+	previousTime = nowMicroseconds;
+	return true;
+}
+
+// ============================
+// StatsStrip::Render
+// ============================
+Element StatsStrip::Render() const
+{
+	const Network::Statistics& network = latest.network;
+	const Decorator warning = color( Color::Yellow );
+	const Decorator normal = nothing;
+
+	char connection[64];
+	snprintf( connection, sizeof( connection ), "rtt %u ms loss %.1f%% lost %llu",
+		network.roundTripTime, network.packetLoss * 100.0f, (unsigned long long)network.messagesLost );
+
+	char frame[96];
+	snprintf( frame, sizeof( frame ), "frame %.2f ms %.0f fps %.1f msg/frame dropped %llu",
+		averageFrameTime / 1000.0f, framesPerSecond, messagesPerFrame, (unsigned long long)droppedFrames );
+
+	return hbox(
+		{
+			text( "in " + FormatCount( messagesPerSecond ) + " msg/s " + FormatBytes( bytesPerSecond ) + "/s" ),
+			separatorLight(),
+			text( connection ) | (network.packetLoss > 0.0f || network.messagesLost > 0U ? warning : normal),
+			separatorLight(),
+			text( "queue " + std::to_string( latest.queueDepth ) + " dropped " + std::to_string( latest.droppedMessages ) )
+				| (latest.droppedMessages > 0U ? warning : normal),
+			separatorLight(),
+			text( frame ) | (droppedFrames > 0U ? warning : normal),
+			separatorLight(),
+			text( "history " + std::to_string( latest.historySize ) + "/" + std::to_string( latest.historyCapacity )
+				+ " " + FormatBytes( double( latest.historyBytes ) ) ),
+			filler()
+		} ) | dim;
+}
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2023 Admer Šuko
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <ftxui/dom/elements.hpp>
+#include "Network/Network.hpp"
+#include "FramePacer.hpp"
+
+// ============================
+// StatsStrip
+//
+// A line of live figures under the title bar, to tell whether the network,
+// the engine or the rendering is what's falling behind:
+// in 12.3k msg/s 845 KiB/s │ rtt 1 ms loss 0.0% lost 0 │ queue 0 dropped 0 │ frame 1.20 ms 60 fps 210.5 msg/frame dropped 0 │ history 1024/1024 12.5 MiB
+//
+// Everything comes from running totals the hot paths keep anyway, rates are worked out
+// here from the difference between two samples. Nothing is sampled or timed while it's hidden.
+// ============================
+class StatsStrip final
+{
+public:
+	struct Sample
+	{
+		Network::Statistics network;
+		FramePacer::Statistics frames;
+		size_t queueDepth;
+		size_t droppedMessages;
+		size_t historySize;
+		size_t historyCapacity;
+		size_t historyBytes;
+	};
+
+public:
+	// Rates are only recomputed once this much time has passed, so they don't flicker
+	static constexpr uint64_t SampleIntervalMicroseconds = 500'000U;
+
+	// Whether the figures are due for a refresh, so the sample only has to be taken then
+	bool IsDue( uint64_t nowMicroseconds ) const
+	{
+		return previousTime == 0U || nowMicroseconds < previousTime || nowMicroseconds - previousTime >= SampleIntervalMicroseconds;
+	}
+
+	// Call when IsDue, returns true when the rates were recomputed
+	bool Update( const Sample& sample, uint64_t nowMicroseconds );
+	// Forgets the last sample, so rates start over when the strip is shown again
+	void Reset()
+	{
+		previousTime = 0U;
+	}
+
+	ftxui::Element Render() const;
+
+private:
+	Sample latest{};
+	Sample previous{};
+	uint64_t previousTime{ 0U };
+
+	float messagesPerSecond{ 0.0f };
+	float bytesPerSecond{ 0.0f };
+
+	float framesPerSecond{ 0.0f };
+	float averageFrameTime{ 0.0f };
+	float messagesPerFrame{ 0.0f };
+	uint64_t droppedFrames{ 0U };
+};
@@ -1,33 +1,80 @@
-
 // Taken from:
 // https://github.com/ArthurSonzogni/git-tui/blob/master/src/scroller.cpp
+// 
+// Modified to be virtualised: instead of rendering a child component
+// in its entirety and measuring it, the scroller asks for the range of
+// rows that exist and only builds Elements for the ones around the view.
+// Rows can also be selected from outside, e.g. to jump to a search match.
 
 #pragma once
 
 namespace ftxui
 {
+	// Row indices [begin, end) the scroller can move through
+	struct ScrollerRange
+	{
+		size_t begin;
+		size_t end;
+	};
+
+	// Returns the rows that currently exist, must be cheap to call
+	using ScrollerRangeFn = ScrollerRange();
+	// Builds a vertical stack of rows [first, last), one line each
+	using ScrollerRowsFn = Element( size_t first, size_t last );
+
 	class ScrollerBase : public ComponentBase
 	{
 	public:
-		ScrollerBase( Component child ) { Add( child ); }
+		ScrollerBase( std::function<ScrollerRangeFn> range, std::function<ScrollerRowsFn> rows )
+			: getRange( std::move( range ) ), renderRows( std::move( rows ) )
+		{
+		}
+
+		// Centres the view on a row, it's clamped to the range on the next frame
+		void Select( size_t row )
+		{
+			selected_ = row;
+		}
 
 	private:
+		// Used before the scroller knows how tall it is
+		static constexpr int DefaultHeight = 100;
+		// Extra rows built above and below the view
+		static constexpr size_t Overscan = 4U;
+
+	public:
 		Element Render() final
 		{
 			auto focused = Focused() ? focus : ftxui::select;
 			auto style = Focused() ? inverted : nothing;
 
-			Element background = ComponentBase::Render();
-			background->ComputeRequirement();
-			size_ = background->requirement().min_y;
-			return dbox( {
-					   std::move( background ),
-					   vbox( {
-						   text( L"" ) | size( HEIGHT, EQUAL, selected_ ),
-						   text( L"" ) | style | focused,
-					   } ),
-				} ) |
-				vscroll_indicator | yframe | yflex | reflect( box_ );
+			range_ = getRange();
+			ClampSelection();
+
+			const size_t numRows = range_.end - range_.begin;
+			if ( numRows == 0U )
+			{
+				return text( L"" ) | yflex | reflect( box_ );
+			}
+
+			// The frame centres the selected row, so everything within
+			// a view's height of it on either side may end up visible
+			const size_t height = ViewHeight();
+			const size_t first = selected_ - std::min( selected_ - range_.begin, height + Overscan );
+			const size_t last = selected_ + std::min( range_.end - selected_, height + Overscan );
+
+			Element rows = dbox( {
+					renderRows( first, last ),
+					vbox( {
+						text( L"" ) | size( HEIGHT, EQUAL, int( selected_ - first ) ),
+						text( L"" ) | style | focused,
+					} ),
+				} ) | yframe | yflex;
+
+			return hbox( {
+					std::move( rows ) | xflex,
+					ScrollIndicator( numRows, height ),
+				} ) | yflex | reflect( box_ );
 		}
 
 		bool OnEvent( Event event ) final
@@ -35,38 +82,85 @@ namespace ftxui
 			if ( event.is_mouse() && box_.Contain( event.mouse().x, event.mouse().y ) )
 				TakeFocus();
 
-			int selected_old = selected_;
+			// Rows may have been added or evicted since the last frame, End has to reach the newest one
+			range_ = getRange();
+			if ( range_.begin == range_.end )
+				return false;
+
+			const size_t selected_old = selected_;
+			const size_t page = ViewHeight();
 			if ( event == Event::ArrowUp || event == Event::Character( 'k' ) ||
 				(event.is_mouse() && event.mouse().button == Mouse::WheelUp) ) {
-				selected_--;
+				selected_ = selected_ > range_.begin ? selected_ - 1U : range_.begin;
 			}
 			if ( (event == Event::ArrowDown || event == Event::Character( 'j' ) ||
 				(event.is_mouse() && event.mouse().button == Mouse::WheelDown)) ) {
 				selected_++;
 			}
 			if ( event == Event::PageDown )
-				selected_ += box_.y_max - box_.y_min;
+				selected_ += page;
 			if ( event == Event::PageUp )
-				selected_ -= box_.y_max - box_.y_min;
+				selected_ = selected_ > range_.begin + page ? selected_ - page : range_.begin;
 			if ( event == Event::Home )
-				selected_ = 0;
+				selected_ = range_.begin;
 			if ( event == Event::End )
-				selected_ = size_;
+				selected_ = range_.end;
 
-			selected_ = std::max( 0, std::min( size_ - 1, selected_ ) );
+			ClampSelection();
 			return selected_old != selected_;
 		}
 
 		bool Focusable() const final { return false; }
 
-		int selected_ = 0;
-		int size_ = 0;
+	private:
+		void ClampSelection()
+		{
+			if ( range_.begin == range_.end )
+			{
+				selected_ = range_.begin;
+				return;
+			}
+
+			selected_ = std::max( range_.begin, std::min( range_.end - 1U, selected_ ) );
+		}
+
+		size_t ViewHeight() const
+		{
+			const int height = box_.y_max - box_.y_min + 1;
+			return height > 1 ? size_t( height ) : size_t( DefaultHeight );
+		}
+
+		// vscroll_indicator only knows about the rows that were built,
+		// so draw one that accounts for the whole range
+		Element ScrollIndicator( size_t numRows, size_t height ) const
+		{
+			if ( numRows <= height )
+			{
+				return text( L"" ) | size( WIDTH, EQUAL, 1 );
+			}
+
+			const size_t thumbSize = std::max<size_t>( 1U, height * height / numRows );
+			const size_t topRow = selected_ - range_.begin - std::min( selected_ - range_.begin, height / 2U );
+			const size_t thumbTop = std::min( height - thumbSize, topRow * height / numRows );
+
+			return vbox( {
+					text( L"" ) | size( HEIGHT, EQUAL, int( thumbTop ) ),
+					text( L"" ) | size( HEIGHT, EQUAL, int( thumbSize ) ) | size( WIDTH, EQUAL, 1 ) | inverted,
+					filler(),
+				} ) | size( WIDTH, EQUAL, 1 );
+		}
+
+		std::function<ScrollerRangeFn> getRange;
+		std::function<ScrollerRowsFn> renderRows;
+
+		ScrollerRange range_{ 0U, 0U };
+		size_t selected_ = 0U;
 		Box box_;
 	};
 
-	inline Component Scroller( Component child )
+	inline std::shared_ptr<ScrollerBase> Scroller( std::function<ScrollerRangeFn> range, std::function<ScrollerRowsFn> rows )
 	{
-		return Make<ScrollerBase>( std::move( child ) );
+		return Make<ScrollerBase>( std::move( range ), std::move( rows ) );
 	}
 }  // namespace ftxui
 